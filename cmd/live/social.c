@@ -1979,8 +1979,10 @@ sort_name(object a, object b)
  * Function name: print_who
  * Description  : This function actually prints the list of people known.
  * Arguments    : string opts - the command line arguments.
- *                object *list - the list of livings to display (met).
- *                object *nonmet - the list of livings we have not met.
+ *                object *list - the list of livings to display (met), sorted
+ *                               by name.
+ *                object *nonmet - the list of livings we have not met, sorted
+ *                                 by name.
  *                int    size - the number of people logged in.
  * Returns      : int 1 - always.
  */
@@ -2022,7 +2024,6 @@ print_who(string opts, object *list, object *nonmet, int size)
 
     if (show_unmet)
     {
-        nonmet = sort_array(nonmet, sort_name);
         nonnames = map(nonmet, format_who_name);
     }
     scrw = ((scrw >= 40) ? (scrw - 3) : 77);
@@ -2032,7 +2033,6 @@ print_who(string opts, object *list, object *nonmet, int size)
      */
     if (OPTION_USED("f", opts))
     {
-        list = sort_array(list, sort_name);
         foreach(object person: list)
         {
             words = explode(person->query_presentation(), " ");
@@ -2042,9 +2042,10 @@ print_who(string opts, object *list, object *nonmet, int size)
     }
     else if (sizeof(list))
     {
-        list = sort_array(list, sort_name);
         /* This preserves the sorted list. */
-        wizards = filter(list, &->query_wiz_level());
+        wizards = PRESENCE_CENTRAL->query_players(
+            PRESENCE_CENTRAL->query_names(PRESENCE_WIZARD));
+        wizards = list - (list - wizards);
         list -= wizards;
         metnames = map(list, format_who_name);
         if (sizeof(wizards))
@@ -2105,13 +2106,21 @@ print_who(string opts, object *list, object *nonmet, int size)
     return 1;
 }
 
+/*
+ * Function name: who
+ * Description  : Lists the players in the game. The lists are taken from the
+ *                presence registry, which keeps sorted lists of names by
+ *                category, so we only need set operations here.
+ * Arguments    : string opts - the command line options.
+ * Returns      : int 1 - always.
+ */
 int
 who(string opts)
 {
-    object *list = users();
-    object *wizards;
-    object *nonmet = ({ });
-    object  npc, room;
+    string *list;
+    string *wizards;
+    string *nonmet = ({ });
+    object *players;
     mapping rem;
     mapping memory = ([ ]);
     string *names = ({ });
@@ -2123,25 +2132,29 @@ who(string opts)
         opts = "";
     }
 
+    list = PRESENCE_CENTRAL->query_names(0);
+
 #ifdef STATUE_WHEN_LINKDEAD
 #ifdef OWN_STATUE
     /* If there is a room where statues of linkdead people can be found,
-     * we add that to the list, but only if the player did not ask to only
-     * see the interactive players.
+     * we show those too, but only if the player did not ask to only see
+     * the interactive players.
      */
-    if (!OPTION_USED("i", opts) && objectp(room = find_object(OWN_STATUE)))
+    if (OPTION_USED("i", opts))
     {
-        list |= (object *)room->query_linkdead_players();
+        list -= PRESENCE_CENTRAL->query_names(PRESENCE_LINKDEAD);
     }
+#else
+    list -= PRESENCE_CENTRAL->query_names(PRESENCE_LINKDEAD);
 #endif OWN_STATUE
+#else
+    list -= PRESENCE_CENTRAL->query_names(PRESENCE_LINKDEAD);
 #endif STATUE_WHEN_LINKDEAD
 
-    /* This filters out players logging in and such. */
-    list = FILTER_LIVING_OBJECTS(list);
     size = sizeof(list);
 
     /* Player may indicate to see only wizards or mortals. */
-    wizards = filter(list, &->query_wiz_level());
+    wizards = list - PRESENCE_CENTRAL->query_names(PRESENCE_MORTAL);
     if (OPTION_USED("w", opts))
     {
         list = wizards;
@@ -2156,7 +2169,8 @@ who(string opts)
      */
     if (this_player()->query_wiz_level())
     {
-        return print_who(opts, list, ({ }), size);
+        return print_who(opts, PRESENCE_CENTRAL->query_players(list), ({ }),
+            size);
     }
 
     if (mappingp(rem = this_player()->query_remembered()))
@@ -2188,33 +2202,38 @@ who(string opts)
         return 1;
     }
 
-    /* Only add NPC's if the player didn't use the wizard filter. */
-    if (!OPTION_USED("w", opts))
-    {
-#ifdef NPC_IN_WHO_LIST
-        names = m_indices(memory) - list->query_real_name();
-        list |= map(names, find_living);
-        list = filter(list, objectp);
-#endif NPC_IN_WHO_LIST
-    }
-
     /* Mortals do not see invisible wizards. */
-    list -= filter(wizards, &operator(>=)(, 100) @ &->query_prop(OBJ_I_INVIS));
+    list -= PRESENCE_CENTRAL->query_names(PRESENCE_INVIS);
 
     /* Mortals do not see juniors. */
-    list = filter(list, not @ &wildmatch("*jr", ) @ &->query_real_name());
+    list -= PRESENCE_CENTRAL->query_names(PRESENCE_JUNIOR);
 
 #ifdef MET_ACTIVE
     /* Find out who on the list is not known to us. */
-    nonmet = filter(list, not @ &operator([])(memory, ) @ &->query_real_name());
+    nonmet = filter(list, not @ &operator([])(memory, ));
     /* Except of course those who are always known. */
-    nonmet = filter(nonmet, not @ &->query_prop(LIVE_I_ALWAYSKNOWN));
+    players = PRESENCE_CENTRAL->query_players(nonmet);
+    nonmet -= filter(players, &->query_prop(LIVE_I_ALWAYSKNOWN))->
+        query_real_name();
     /* We always know ourselves. */
-    nonmet -= ({ this_player() });
+    nonmet -= ({ this_player()->query_real_name() });
     list -= nonmet;
     /* Mortals don't see nonmet wizards on the who-list. */
     nonmet -= wizards;
 #endif MET_ACTIVE
 
-    return print_who(opts, list, nonmet, size);
+    players = PRESENCE_CENTRAL->query_players(list);
+
+    /* Only add NPC's if the player didn't use the wizard filter. */
+    if (!OPTION_USED("w", opts))
+    {
+#ifdef NPC_IN_WHO_LIST
+        names = m_indices(memory) - PRESENCE_CENTRAL->query_names(0);
+        players = sort_array(players + filter(map(names, find_living),
+            objectp), sort_name);
+#endif NPC_IN_WHO_LIST
+    }
+
+    return print_who(opts, players, PRESENCE_CENTRAL->query_players(nonmet),
+        size);
 }
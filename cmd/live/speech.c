@@ -48,8 +48,17 @@ varargs int say_text(string str, string adverb = "");
 public int say_to(string str, function display_speech);
 varargs int shout(string str, string adverb = NO_ADVERB);
 
-/* Global variable. */
+/*
+ * Global variables.
+ *
+ * gShout_text   - the text of the shout being delivered.
+ * gHook_calls   - the number of calls to speech_hook() made.
+ * gHook_avoided - the number of livings that heard speech but were not
+ *                 called, since they do not define speech_hook().
+ */
 static string gShout_text;
+static int    gHook_calls;
+static int    gHook_avoided;
 
 /*
  * Function name: create
@@ -117,6 +126,46 @@ using_soul(object live)
 {
 }
 
+/*
+ * Function name: speech_listeners
+ * Description  : Finds out which of the livings that hear the speech want to
+ *                be told about it through speech_hook(). The room knows,
+ *                see filter_speech_hooks() in the container. When the
+ *                environment does not know, all livings are called, as
+ *                before.
+ * Arguments    : object *livings - the livings that hear the speech.
+ * Returns      : object * - the livings to call speech_hook() in.
+ */
+static object *
+speech_listeners(object *livings)
+{
+    object env = environment(this_player());
+    mixed  hooks = (objectp(env) ? env->filter_speech_hooks(livings) : 0);
+
+    if (!pointerp(hooks))
+    {
+        gHook_calls += sizeof(livings);
+        return livings;
+    }
+
+    gHook_calls += sizeof(hooks);
+    gHook_avoided += sizeof(livings) - sizeof(hooks);
+    return hooks;
+}
+
+/*
+ * Function name: query_speech_hook_stats
+ * Description  : Gives the number of calls to speech_hook() made and the
+ *                number of calls avoided, since the livings that heard the
+ *                speech do not define it.
+ * Returns      : int * - ({ (int) calls, (int) avoided })
+ */
+public int *
+query_speech_hook_stats()
+{
+    return ({ gHook_calls, gHook_avoided });
+}
+
 /*
  * Function name: notify_speech
  * Description  : This function is used by the various speech methods to
@@ -139,7 +188,7 @@ notify_speech(string verb, string adverb, object *oblist, string text)
 
     livings = FILTER_OTHER_LIVE(all_inventory(environment(this_player())));
 
-    foreach(object npc: livings)
+    foreach(object npc: speech_listeners(livings))
     {
         if (is_target = target)
         {
@@ -306,8 +355,10 @@ ask(string str)
     person->reveal_me(1);
 
     /* Onlookers don't get the question that was asked. */
-    person->speech_hook("ask", this_player(), "", oblist, msg, 1);
-    livings->speech_hook("ask", this_player(), "", oblist, "", -1);
+    speech_listeners( ({ person }) )->speech_hook("ask", this_player(), "",
+        oblist, msg, 1);
+    speech_listeners(livings)->speech_hook("ask", this_player(), "", oblist,
+        "", -1);
 
     return 1;
 }
@@ -1364,8 +1415,10 @@ print_whisper_to(string adverb, object *oblist, string str)
     oblist->catch_whisper(str);
 
     /* Onlookers don't get what was being whispered. */
-    livings->speech_hook("whisper", this_player(), adverb, oblist, "", -1);
-    oblist->speech_hook("whisper", this_player(), adverb, oblist, str, 1);
+    speech_listeners(livings)->speech_hook("whisper", this_player(), adverb,
+        oblist, "", -1);
+    speech_listeners(oblist)->speech_hook("whisper", this_player(), adverb,
+        oblist, str, 1);
 }
 
 int
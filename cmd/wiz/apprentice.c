@@ -1022,7 +1022,8 @@ finger(string str)
         names = QUEUE->queue_list(1);
         if (!(size = sizeof(names)))
         {
-            write("There are no players in the queue right now.\n");
+            write("There are no players in the queue right now.\n" +
+                QUEUE->query_stats() + LOGIN_PIPELINE->query_stats());
             return 1;
         }
 
@@ -1032,7 +1033,8 @@ finger(string str)
             names[index] = sprintf("%2d: %s", (index + 1), names[index]);
         }
         write("The following people are in the queue:\n" +
-            sprintf("%-70#s\n", implode(names, "\n")));
+            sprintf("%-70#s\n", implode(names, "\n")) +
+            QUEUE->query_stats() + LOGIN_PIPELINE->query_stats());
         return 1;
     }
 
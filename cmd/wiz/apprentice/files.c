@@ -247,6 +247,7 @@ list_files(string path)
     string  prefix;
     string *files;
     string *items;
+    mapping indexed;
     int     scrw = this_player()->query_option(OPT_SCREEN_WIDTH);
 
     CHECK_SO_WIZ;
@@ -363,9 +364,26 @@ list_files(string path)
 	/* Allow for long file names, but at least 20 chars. */
         int len = max(20, min((scrw-32), applyv(max, map(items, strlen))) + 1);
 
+	/* The file index saves asking the driver for every file. */
+	if (!mappingp(indexed = FILE_INDEX->query_dir(path)))
+	{
+	    indexed = ([ ]);
+	}
+
 	foreach(string fname: items)
 	{
-	    if ((j = file_size(path + fname)) == -2)
+	    if (pointerp(indexed[fname]))
+	    {
+		j = indexed[fname][0];
+		tmp = indexed[fname][1];
+	    }
+	    else
+	    {
+		j = file_size(path + fname);
+		tmp = file_time(path + fname);
+	    }
+
+	    if (j == -2)
 	    {
 		if (mf)
 		{
@@ -383,7 +401,7 @@ list_files(string path)
 		prefix =  "-";
 	    }
 
-	    tmp = ctime(file_time(path + fname));
+	    tmp = ctime(tmp);
 	    tmp = tmp[4..9] + tmp[19..23] + tmp[10..15];
 
 	    files += ({ sprintf("%1s %-*s%10d  %s", prefix, len, fname, j, tmp) });
@@ -674,6 +692,7 @@ int
 build_tree(string path, int spaces, int printed)
 {
     string *files;
+    mapping indexed;
     int    index = -1;
     int    size;
     int    this_level = 0;
@@ -683,13 +702,23 @@ build_tree(string path, int spaces, int printed)
 	return -1;
     }
 
-    if (!pointerp(files = get_dir(path + "*")))
+    /* Use the file index when it has the directory. */
+    if (mappingp(indexed = FILE_INDEX->query_dir(path)))
     {
-	return printed;
+	files = sort_array(filter(m_indices(indexed),
+	    &operator(==)(-2) @ &operator([])(, 0) @ &operator([])(indexed, )));
+	files = map(files, &operator(+)(path, ));
     }
+    else
+    {
+	if (!pointerp(files = get_dir(path + "*")))
+	{
+	    return printed;
+	}
 
-    files = map((files - ({ ".", ".." }) ), &operator(+)(path, ));
-    files = filter(files, &operator(==)(-2) @ file_size);
+	files = map((files - ({ ".", ".." }) ), &operator(+)(path, ));
+	files = filter(files, &operator(==)(-2) @ file_size);
+    }
 
     if (!(size = sizeof(files)))
     {
@@ -318,6 +318,27 @@ lman(string entry, string docdir)
 /* **************************************************************************
  * man - display a manual page
  */
+
+/*
+ * Function name: man_text
+ * Description  : Searches the text of the manual pages with the document
+ *                index and lists the pages found, best first.
+ * Arguments    : string *words - the words to search for.
+ * Returns      : int 1/0 - true if something was found.
+ */
+static nomask int
+man_text(string *words)
+{
+    string *files = DOC_INDEX->query_search(implode(words, " "), MANHEAD);
+
+    if (!sizeof(files))
+        return 0;
+
+    write("Pages about '" + implode(words, " ") + "':\n" +
+        sprintf("%-*#s\n", 76,
+        implode(map(files, &extract(, strlen(MANHEAD), -1)), "\n")));
+    return 1;
+}
 nomask int
 man(string entry)
 {
@@ -354,7 +375,8 @@ man(string entry)
                         wr_flag = 1;
                     }
                 }
-                if (!wr_flag)
+                /* Nothing by name, try the text of the pages. */
+                if (!wr_flag && !man_text(argv[1..]))
                     write("No such chapter.\n");
             }
             else
@@ -384,6 +406,15 @@ man(string entry)
         write("Try 'man -c' to see possible chapters.\n");
         break;
 
+    case "-t":
+        if ((argc < 2) || !man_text(argv[1..]))
+            write("Nothing found.\n");
+        break;
+
+    case "-i":
+        write(DOC_INDEX->query_status());
+        break;
+
     case "-c":
         write("Available chapters:\n" +
             sprintf("%-*#s\n", 76, implode(MANCTRL->get_chapters(), "\n")));
@@ -593,6 +593,8 @@ mbs_cmd(string arg)
 	    mbm_error(MC->generate_report(3));
 	else if (first[0..1] == "tr")
 	    mbm_error(MC->generate_report(4));
+	else if (first == "s")
+	    mbm_error(MC->generate_report(5));
 
 	break;
 	
@@ -129,6 +129,7 @@ query_cmdlist()
              "clone":"clone",
              "cmdsoul":"cmdsoul",
              "combatdata":"combatdata",
+             "combatlog":"combatlog",
              "combatstat":"combatstat",
              "control":"control",
              "cp":"cp_cmd",
@@ -146,9 +147,14 @@ query_cmdlist()
              "errlog":"errlog",
              "exec":"exec_code",
              "execr":"exec_code",
+             "expgiven":"expgiven",
 
              "force":"force",
 
+             "gmcpstat":"gmcpstat",
+
+             "hookstat":"hookstat",
+
              "idealog":"idealog",
              "invis":"invis",
 
@@ -407,6 +413,57 @@ combatdata(string str)
     return 1;
 }
 
+/* **************************************************************************
+ * combatlog - query the log of hits and misses in combat
+ */
+nomask int
+combatlog(string str)
+{
+    string *args;
+    int    hours = 1;
+    int    dps;
+
+    CHECK_SO_WIZ;
+
+    if (!strlen(str))
+    {
+        write(COMBAT_LOG->query_status());
+        return 1;
+    }
+
+    if (str == "flush")
+    {
+        COMBAT_LOG->flush();
+        write("Combat log flushed.\n");
+        return 1;
+    }
+
+    args = explode(str, " ");
+    foreach(string arg: args[1..])
+    {
+        if (arg == "dps")
+        {
+            dps = 1;
+        }
+        else if (!sscanf(arg, "%d", hours))
+        {
+            args = ({ });
+            break;
+        }
+    }
+
+    if (!sizeof(args) ||
+        !COMBAT_LOG->query_aggregate(args[0], hours, dps))
+    {
+        notify_fail("Syntax: combatlog [flush]\n" +
+            "        combatlog weapon / attacker / victim [<hours>] [dps]\n");
+        return 0;
+    }
+
+    write("Reading the combat log, the result follows.\n");
+    return 1;
+}
+
 /* *************************************************************************
  * combatstat - Show some combat statistics for a living object
  */
@@ -500,6 +557,44 @@ errlog(string str)
     return somelog(str, "error log", "/errors");
 }
 
+/* **************************************************************************
+ * expgiven - list the experience given by the domains
+ */
+nomask int
+expgiven(string str)
+{
+    string *args;
+    string dname = 0;
+    int    days = 7;
+
+    CHECK_SO_WIZ;
+
+    args = (stringp(str) ? explode(str, " ") : ({ }));
+    foreach(string arg: args)
+    {
+        if (sscanf(arg, "%d", days))
+        {
+            continue;
+        }
+
+        dname = capitalize(lower_case(arg));
+        if (!IN_ARRAY(dname, SECURITY->query_domain_list()))
+        {
+            notify_fail("There is no domain named " + dname + ".\n");
+            return 0;
+        }
+    }
+
+    if (days < 1)
+    {
+        notify_fail("Syntax: expgiven [<domain>] [<days>]\n");
+        return 0;
+    }
+
+    this_player()->more(SECURITY->query_exp_given(dname, days));
+    return 1;
+}
+
 /* **************************************************************************
  * force - force a player to do something
  */
@@ -555,6 +650,84 @@ force(string str)
     return 1;
 }
 
+/* **************************************************************************
+ * gmcpstat - the statistics of incoming GMCP
+ */
+nomask int
+gmcpstat(string str)
+{
+    CHECK_SO_WIZ;
+
+    if (str == "clear")
+    {
+        if (!SECURITY->clear_gmcp_stats())
+        {
+            notify_fail("You may not clear the GMCP statistics.\n");
+            return 0;
+        }
+
+        write("GMCP statistics cleared.\n");
+        return 1;
+    }
+
+    if (strlen(str) &&
+        !IN_ARRAY(str, ({ "count", "cost", "dropped" })))
+    {
+        notify_fail("Syntax: gmcpstat [count / cost / dropped]\n" +
+            "        gmcpstat clear\n");
+        return 0;
+    }
+
+    this_player()->more(SECURITY->query_gmcp_stats(strlen(str) ? str :
+        "count"));
+    return 1;
+}
+
+/* **************************************************************************
+ * hookstat - profile the hooks called through call_hook()
+ */
+nomask int
+hookstat(string str)
+{
+    string *args;
+    string order = "cost";
+    int    count = 20;
+
+    CHECK_SO_WIZ;
+
+    switch(str)
+    {
+    case "on":
+    case "off":
+        HOOK_PROFILER->set_active(str == "on");
+        write("Hook profiling is now " + str + ".\n");
+        return 1;
+
+    case "clear":
+        HOOK_PROFILER->clear();
+        write("Hook statistics cleared.\n");
+        return 1;
+    }
+
+    args = (stringp(str) ? explode(str, " ") : ({ }));
+    foreach(string arg: args)
+    {
+        if (IN_ARRAY(arg, ({ "calls", "cost", "errors" })))
+        {
+            order = arg;
+        }
+        else if (!sscanf(arg, "%d", count))
+        {
+            notify_fail("Syntax: hookstat [on / off / clear]\n" +
+                "        hookstat [calls / cost / errors] [<number>]\n");
+            return 0;
+        }
+    }
+
+    this_player()->more(HOOK_PROFILER->query_top(count, order));
+    return 1;
+}
+
 /* **************************************************************************
  * idealog - read the idea log
  */
@@ -36,6 +36,7 @@
 static private object  loadmany_wizard;
 static private string *loadmany_files;
 static private string *loadmany_going = ({ });
+static private mapping loadbatch      = ([ ]);
 
 static private mapping aft_tracked;
 static private mapping aft_current = ([ ]);
@@ -1074,51 +1075,66 @@ nomask int
 du(string str)
 {
     int aflag;
-    string p, flag, path;
+    int sflag;
+    int *usage;
+    string p, path;
+    string *args;
 
-    if (!str)
+    CHECK_SO_WIZ;
+
+    args = (stringp(str) ? explode(str, " ") : ({ }));
+    if (IN_ARRAY("-i", args))
     {
-        path = ".";
+        this_player()->more(FILE_INDEX->query_status());
+        return 1;
     }
-    else
+
+    aflag = IN_ARRAY("-a", args);
+    sflag = IN_ARRAY("-s", args);
+    args -= ({ "-a", "-s" });
+    if (sizeof(args) > 1)
     {
-        /* There is no getopt in CDlib... or? */
-        if (sscanf(str, "%s %s", flag, path) == 2)
-        {
-            if (flag != "-a")
-            {
-                notify_fail("usage: du [-a] [path]\n");
-                return 0;
-            }
-            else
-                aflag = 1;
-        }
-        else
-        {
-            if (str == "-a")
-            {
-                aflag = 1;
-                path = ".";
-            }
-            else
-                path = str;
-        }
+        notify_fail("usage: du [-a | -s | -i] [path]\n");
+        return 0;
     }
+
+    path = (sizeof(args) ? args[0] : ".");
     p = FTPATH(this_interactive()->query_path(), path);
 
     if (p == "/")
         p = "";
 
+    if (sflag)
+    {
+        if (!pointerp(usage = FILE_INDEX->query_usage(p)))
+        {
+            write("Not indexed yet, counting the files myself.\n");
+            xdu(p, 0);
+            return 1;
+        }
+
+        write(usage[0] / 1024 + "\t" + p + "\t(" + usage[1] + " files)\n");
+        return 1;
+    }
+
     xdu(p, aflag);
 
         return 1;
 }
 
+/*
+ * Function name: xdu_disk
+ * Description  : Counts the disk usage of a directory that is not in the
+ *                file index by reading the disk.
+ * Arguments    : string path - the directory.
+ *                int aflag - if true, list all files.
+ * Returns      : int - the number of bytes.
+ */
 static nomask int
-xdu(string path, int aflag)
+xdu_disk(string path, int aflag)
 {
-    int sum, i;
-    string *files, output;
+    int sum, i, size;
+    string *files;
 
     files = get_dir(path + "/*");
 
@@ -1129,16 +1145,55 @@ xdu(string path, int aflag)
         if (files[i] == "." || files[i] == "..")
             continue;
 
-        if (aflag && file_size(path + "/" + files[i]) > -1)
+        size = file_size(path + "/" + files[i]);
+        if (aflag && size > -1)
         {
-            write(file_size(path + "/" + files[i]) / 1024 + "\t" +
-                  path + "/" + files[i] + "\n");
+            write(size / 1024 + "\t" + path + "/" + files[i] + "\n");
         }
 
-        if (file_size(path + "/" + files[i]) == -2)
+        if (size == -2)
             sum += xdu(path + "/" + files[i], aflag);
         else
-            sum += file_size(path + "/" + files[i]);
+            sum += size;
+    }
+
+    write(sum / 1024 + "\t" + path + "\n");
+    return sum;
+}
+
+/*
+ * Function name: xdu
+ * Description  : Counts and prints the disk usage of a directory and all
+ *                directories below it. The file index is used where it
+ *                has the directory.
+ * Arguments    : string path - the directory.
+ *                int aflag - if true, list all files.
+ * Returns      : int - the number of bytes.
+ */
+static nomask int
+xdu(string path, int aflag)
+{
+    int sum;
+    mapping files = FILE_INDEX->query_dir(strlen(path) ? path : "/");
+
+    if (!mappingp(files))
+    {
+        return xdu_disk(path, aflag);
+    }
+
+    foreach(string name: sort_array(m_indices(files)))
+    {
+        if (files[name][0] == -2)
+        {
+            sum += xdu(path + "/" + name, aflag);
+            continue;
+        }
+
+        if (aflag && files[name][0] > -1)
+        {
+            write(files[name][0] / 1024 + "\t" + path + "/" + name + "\n");
+        }
+        sum += max(files[name][0], 0);
     }
 
     write(sum / 1024 + "\t" + path + "\n");
@@ -1174,6 +1229,44 @@ ed_file(string file)
 #define LOADMANY_MAX   (10)
 #define LOADMANY_DELAY (5.0)
 
+/*
+ * The batch load harness. Each step loads files until either budget is
+ * used up. The report is kept in the home directory of the wizard:
+ *
+ * ([ BATCH_ROOT     : (string) the directory tree,
+ *    BATCH_DIRS     : (string *) directories still to scan,
+ *    BATCH_FILES    : (string *) files still to load,
+ *    BATCH_RESULTS  : ([ (string) file : ({ cpu, eval, memory, error }) ]),
+ *    BATCH_PREVIOUS : the results of the previous run on the same tree,
+ *    BATCH_STARTED  : (int) the time the run started,
+ *    BATCH_FINISHED : (int) the time the run finished, or 0 ])
+ *
+ * The cpu time is in milliseconds and covers both compiling the file and
+ * running create(). The eval cost is mostly create(). The memory is the
+ * growth of the heap of the game in kB, measured before the object is
+ * destructed again.
+ */
+#define LOADBATCH_EVAL     (300000)
+#define LOADBATCH_TIME     (200)
+#define LOADBATCH_DELAY    (2.0)
+#define LOADBATCH_FILE(n)  (SECURITY->wiz_home(n) + "/loadbatch")
+#define LOADBATCH_SLOWER   (10)
+
+#define BATCH_ROOT     ("root")
+#define BATCH_DIRS     ("dirs")
+#define BATCH_FILES    ("files")
+#define BATCH_RESULTS  ("results")
+#define BATCH_PREVIOUS ("previous")
+#define BATCH_STARTED  ("started")
+#define BATCH_FINISHED ("finished")
+
+#define RESULT_CPU     (0)
+#define RESULT_EVAL    (1)
+#define RESULT_MEMORY  (2)
+#define RESULT_ERROR   (3)
+
+static nomask void load_batch();
+
 /*
  * Function name: load_many_delayed
  * Description  : When a wizard wants to test many files in one turn, this
@@ -1214,6 +1307,12 @@ load_many()
     object obj;
     string error;
 
+    if (mappingp(loadbatch[loadmany_wizard->query_real_name()]))
+    {
+        load_batch();
+        return;
+    }
+
     size = (sizeof(loadmany_files) > LOADMANY_MAX) ? LOADMANY_MAX :
         sizeof(loadmany_files);
     while(++index < size)
@@ -1297,6 +1396,318 @@ load_many_delayed_reloaded()
     load_many();
 }
 
+/*
+ * Function name: load_rusage
+ * Description  : Gives the cpu time used by the game.
+ * Returns      : int - the user and system time in ms.
+ */
+static nomask int
+load_rusage()
+{
+    int *usage = map(explode(SECURITY->do_debug("rusage"), " "), atoi);
+
+    return usage[0] + usage[1];
+}
+
+/*
+ * Function name: load_batch_file
+ * Description  : Loads one file of a batch and records the result.
+ * Arguments    : mapping report - the report.
+ *                string file - the file to load.
+ */
+static nomask void
+load_batch_file(mapping report, string file)
+{
+    int   *before;
+    int   *usage;
+    int    eval;
+    object obj;
+    string error;
+
+    /* We can't measure what is already loaded. */
+    if (objectp(find_object(file)))
+    {
+        report[BATCH_RESULTS][file] = ({ -1, 0, 0, 0 });
+        return;
+    }
+
+    /* The maximum resident size only grows, so use the heap size. */
+    before = ({ load_rusage(), SECURITY->query_memory_used() });
+    eval = EVAL_COST;
+    error = catch(call_other(file, "teleledningsanka"));
+    eval = EVAL_COST - eval;
+    usage = ({ load_rusage() - before[0],
+        (SECURITY->query_memory_used() - before[1]) / 1024 });
+    report[BATCH_RESULTS][file] = ({ usage[0], eval, usage[1], error });
+
+    if (error)
+    {
+        tell_object(loadmany_wizard, "Error loading:   " + file +
+            "\nMessage      :   " + error + "\n");
+        return;
+    }
+
+    if (loadmany_wizard->query_option(OPT_ECHO))
+    {
+        tell_object(loadmany_wizard, sprintf("Loaded: %5d ms %8d eval  %s\n",
+            usage[0], eval, file));
+    }
+
+    /* Remove the object from memory again. */
+    catch(call_other(file, "remove_object"));
+    if (objectp(obj = find_object(file)))
+    {
+        SECURITY->do_debug("destroy", obj);
+    }
+}
+
+/*
+ * Function name: load_batch_diff
+ * Description  : Compares the results of a batch with the previous run.
+ * Arguments    : mapping report - the report.
+ * Returns      : string - the differences.
+ */
+static nomask string
+load_batch_diff(mapping report)
+{
+    mapping now = report[BATCH_RESULTS];
+    mapping then = report[BATCH_PREVIOUS];
+    string *files;
+    string *lines = ({ });
+    mixed  *old;
+
+    if (!m_sizeof(then))
+    {
+        return "There is no previous run to compare with.\n";
+    }
+
+    files = sort_array(m_indices(now));
+    foreach(string file: files)
+    {
+        if (!pointerp(old = then[file]))
+        {
+            lines += ({ "New file       : " + file });
+        }
+        else if (now[file][RESULT_ERROR] && !old[RESULT_ERROR])
+        {
+            lines += ({ "New error      : " + file });
+        }
+        else if (!now[file][RESULT_ERROR] && old[RESULT_ERROR])
+        {
+            lines += ({ "Error fixed    : " + file });
+        }
+        else if ((old[RESULT_CPU] >= 0) &&
+            (now[file][RESULT_CPU] > (2 * old[RESULT_CPU])) &&
+            (now[file][RESULT_CPU] - old[RESULT_CPU] >= LOADBATCH_SLOWER))
+        {
+            lines += ({ sprintf("Slower         : %s (%d -> %d ms)", file,
+                old[RESULT_CPU], now[file][RESULT_CPU]) });
+        }
+    }
+
+    foreach(string file: sort_array(m_indices(then) - files))
+    {
+        lines += ({ "Removed file   : " + file });
+    }
+
+    if (!sizeof(lines))
+    {
+        return "No differences with the previous run.\n";
+    }
+
+    return "Differences with the previous run:\n" + implode(lines, "\n") +
+        "\n";
+}
+
+/*
+ * Function name: load_batch_slower
+ * Description  : Sorts files on the cpu time they took, slowest first.
+ */
+static nomask int
+load_batch_slower(mapping results, string a, string b)
+{
+    return results[b][RESULT_CPU] - results[a][RESULT_CPU];
+}
+
+/*
+ * Function name: load_batch_summary
+ * Description  : Gives a summary of the results of a batch.
+ * Arguments    : mapping report - the report.
+ * Returns      : string - the summary.
+ */
+static nomask string
+load_batch_summary(mapping report)
+{
+    int cpu, eval, errors;
+    string *files = m_indices(report[BATCH_RESULTS]);
+    string *slowest;
+    mixed *result;
+
+    foreach(string file: files)
+    {
+        result = report[BATCH_RESULTS][file];
+        cpu += max(result[RESULT_CPU], 0);
+        eval += result[RESULT_EVAL];
+        errors += !!result[RESULT_ERROR];
+    }
+
+    files = sort_array(files, &load_batch_slower(report[BATCH_RESULTS]));
+    slowest = ({ });
+    foreach(string file: files[..4])
+    {
+        slowest += ({ file + " (" + report[BATCH_RESULTS][file][RESULT_CPU] +
+            " ms)" });
+    }
+
+    return sprintf("Batch load of %s: %d files, %d errors, %d ms, %d eval.\n",
+        report[BATCH_ROOT], sizeof(report[BATCH_RESULTS]), errors, cpu, eval) +
+        (sizeof(slowest) ? ("Slowest: " + implode(slowest, ", ") + "\n") : "");
+}
+
+/*
+ * Function name: load_batch
+ * Description  : Does one step of a batch load. Directories are scanned and
+ *                files are loaded until the eval or the time budget of the
+ *                step is used. The report is saved after every step, so the
+ *                batch can be resumed when it is interrupted.
+ */
+static nomask void
+load_batch()
+{
+    string name = loadmany_wizard->query_real_name();
+    mapping report = loadbatch[name];
+    int    eval = EVAL_COST;
+    int    cpu = load_rusage();
+    string path;
+
+    while ((EVAL_COST - eval < LOADBATCH_EVAL) &&
+        (load_rusage() - cpu < LOADBATCH_TIME))
+    {
+        if (sizeof(report[BATCH_FILES]))
+        {
+            path = report[BATCH_FILES][0];
+            report[BATCH_FILES] = report[BATCH_FILES][1..];
+            load_batch_file(report, path);
+            continue;
+        }
+
+        if (!sizeof(report[BATCH_DIRS]))
+        {
+            break;
+        }
+
+        path = report[BATCH_DIRS][0];
+        report[BATCH_DIRS] = report[BATCH_DIRS][1..];
+        foreach(string entry: get_dir(path + "/") - ({ ".", ".." }))
+        {
+            if (file_size(path + "/" + entry) == -2)
+            {
+                report[BATCH_DIRS] += ({ path + "/" + entry });
+            }
+            else if (wildmatch("*.c", entry))
+            {
+                report[BATCH_FILES] += ({ path + "/" + entry });
+            }
+        }
+    }
+
+    if (sizeof(report[BATCH_FILES]) || sizeof(report[BATCH_DIRS]))
+    {
+        save_map(report, LOADBATCH_FILE(name));
+        set_alarm(LOADBATCH_DELAY, 0.0, &load_many_delayed(loadmany_wizard,
+            ({ })));
+    }
+    else
+    {
+        report[BATCH_FINISHED] = time();
+        save_map(report, LOADBATCH_FILE(name));
+        tell_object(loadmany_wizard, "Loading completed.\n" +
+            load_batch_summary(report) + load_batch_diff(report));
+        loadmany_going -= ({ name });
+        m_delkey(loadbatch, name);
+    }
+
+    loadmany_files = 0;
+    loadmany_wizard = 0;
+}
+
+/*
+ * Function name: load_batch_command
+ * Description  : Handles the batch options of the load command.
+ * Arguments    : string str - the arguments after -b.
+ * Returns      : int 1/0 - success/failure.
+ */
+static nomask int
+load_batch_command(string str)
+{
+    string name = this_player()->query_real_name();
+    mapping report;
+
+    if (file_size(LOADBATCH_FILE(name) + ".o") > 0)
+    {
+        catch(report = restore_map(LOADBATCH_FILE(name)));
+    }
+
+    if (str == "diff")
+    {
+        if (!m_sizeof(report))
+        {
+            notify_fail("You have no batch load report.\n");
+            return 0;
+        }
+
+        this_player()->more(load_batch_summary(report) +
+            load_batch_diff(report));
+        return 1;
+    }
+
+    if (member_array(name, loadmany_going) != -1)
+    {
+        notify_fail("You are already loading multiple files. Use " +
+            "\"load stop\" first.\n");
+        return 0;
+    }
+
+    if (str == "resume")
+    {
+        if (!m_sizeof(report) || report[BATCH_FINISHED])
+        {
+            notify_fail("You have no interrupted batch load to resume.\n");
+            return 0;
+        }
+
+        write("Resuming the batch load of " + report[BATCH_ROOT] + ", " +
+            sizeof(report[BATCH_RESULTS]) + " files done.\n");
+    }
+    else
+    {
+        str = FTPATH(this_interactive()->query_path(), str);
+        if (file_size(str) != -2)
+        {
+            notify_fail("No such directory: " + str + "\n");
+            return 0;
+        }
+
+        report = ([ BATCH_ROOT : str,
+            BATCH_DIRS : ({ str }),
+            BATCH_FILES : ({ }),
+            BATCH_RESULTS : ([ ]),
+            BATCH_PREVIOUS : ((mappingp(report) &&
+                (report[BATCH_ROOT] == str) &&
+                report[BATCH_FINISHED]) ? report[BATCH_RESULTS] : ([ ])),
+            BATCH_STARTED : time(),
+            BATCH_FINISHED : 0 ]);
+        write("Loading all files in " + str + ". A delay of " +
+            ftoi(LOADBATCH_DELAY) + " seconds is used between steps.\n");
+    }
+
+    loadbatch[name] = report;
+    loadmany_wizard = this_interactive();
+    loadmany_going += ({ name });
+    load_batch();
+    return 1;
+}
+
 nomask int
 load(string str)
 {
@@ -1329,10 +1740,16 @@ load(string str)
         }
 
         loadmany_going -= ({ this_player()->query_real_name() });
+        m_delkey(loadbatch, this_player()->query_real_name());
         write("Stopped loading multiple files.\n");
         return 1;
     }
 
+    if (wildmatch("-b *", str))
+    {
+        return load_batch_command(str[3..]);
+    }
+
     str = FTPATH(this_interactive()->query_path(), str);
     if (!strlen(str))
     {
@@ -1792,6 +2209,110 @@ update_ob(string str, int recurse)
     return 1;
 }
 
+/*
+ * The number of programs 'update -i' updates without -f.
+ */
+#define UPDATE_INHERIT_MAX (25)
+
+/*
+ * Function name: update_inheritors
+ * Description  : Updates a program and all loaded programs that inherit it.
+ *                The programs are destructed and then reloaded parents
+ *                before children. Clones keep the old programs until they
+ *                are cloned again, so they are only counted. Programs that
+ *                hold players are left alone. More than
+ *                UPDATE_INHERIT_MAX programs are only updated when forced.
+ * Arguments    : string str - the file to update.
+ *                int force - if true, update any number of programs.
+ * Returns      : int 1/0 - success/failure.
+ */
+static nomask int
+update_inheritors(string str, int force)
+{
+    object ob;
+    string *files;
+    string *skipped = ({ });
+    string *failed = ({ });
+    string error;
+    int    clones;
+    int    cpu;
+
+    CHECK_SO_WIZ;
+
+    cpu = load_rusage();
+    str = FTPATH(this_interactive()->query_path(), str);
+    if (!strlen(str) || !objectp(ob = find_object(str)))
+    {
+        notify_fail("No such object.\n");
+        return 0;
+    }
+
+    if ((ob == this_object()) || (ob == find_object(SECURITY)))
+    {
+        notify_fail("Use update without -i for " + MASTER_OB(ob) + ".\n");
+        return 0;
+    }
+
+    str = MASTER_OB(ob) + ".c";
+    files = ({ str }) + SECURITY->query_inherit_users(str);
+    if (!force && (sizeof(files) > UPDATE_INHERIT_MAX))
+    {
+        notify_fail("This would update " + sizeof(files) + " programs. " +
+            "Use update -i -f " + str + " to do so anyway.\n");
+        return 0;
+    }
+
+    foreach(string file: files)
+    {
+        if (!objectp(ob = find_object(file)))
+        {
+            continue;
+        }
+
+        if ((ob == this_object()) ||
+            sizeof(FILTER_PLAYERS(deep_inventory(ob))))
+        {
+            skipped += ({ file });
+            continue;
+        }
+
+        clones += sizeof(object_clones(ob));
+        SECURITY->remove_binary(file);
+        ob->remove_object();
+        if (objectp(ob = find_object(file)))
+        {
+            SECURITY->do_debug("destroy", ob);
+        }
+    }
+
+    files -= skipped;
+    foreach(string file: files)
+    {
+        if (error = catch(file->teleledningsanka()))
+        {
+            failed += ({ file });
+            write("Error loading: " + file + "\nMessage: " + error + "\n");
+        }
+        else if (this_player()->query_option(OPT_ECHO))
+        {
+            write("  " + file + "\n");
+        }
+    }
+
+    write("Updated " + sizeof(files) + " program" +
+        ((sizeof(files) == 1) ? "" : "s") + " in " +
+        (load_rusage() - cpu) + " ms, " + sizeof(failed) +
+        " failed to load. " + clones + " clone" +
+        ((clones == 1) ? " keeps its" : "s keep their") +
+        " old program until cloned again.\n");
+    if (sizeof(skipped))
+    {
+        write("Not updated, players are inside: " +
+            COMPOSITE_WORDS(skipped) + ".\n");
+    }
+    return 1;
+}
+
 nomask int
 update(string str)
 {
@@ -1808,6 +2329,11 @@ update(string str)
     args = explode(str, " ");
     recurse = IN_ARRAY("-r", args);
     dirupd = IN_ARRAY("-d", args);
+    if (IN_ARRAY("-i", args))
+    {
+        return update_inheritors(implode(args - ({ "-i", "-f" }), " "),
+            IN_ARRAY("-f", args));
+    }
     args -= ({ "-r", "-d" });
     str = implode(args, " ");
 
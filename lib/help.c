@@ -18,6 +18,7 @@ static string  help_default;
 static string *help_categories = ({ });
 static mapping help_topics = ([ ]);
 
+#include <files.h>
 #include <macros.h>
 #include <options.h>
 
@@ -126,7 +127,7 @@ process_help(string category, string topic)
             return (result == NO_DISPLAY_DONE);
         }
 
-        topics = get_dir(help_dir + "/*.help");
+        topics = DOC_INDEX->query_files(help_dir, "*.help");
         topics = map(topics, &extract(, 0, -6));
         topics |= m_indices(help_topics);
 
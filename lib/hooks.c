@@ -4,9 +4,19 @@
  * without resorting to shadows.
  *
  */
+#include <files.h>
+#include <macros.h>
 #include <stdproperties.h>
 
+/*
+ * The number of seconds call_hook() keeps whether hook profiling is on
+ * before it asks HOOK_PROFILER again.
+ */
+#define PROFILE_CHECK (10)
+
 static mapping hooks = ([ ]);
+static int     profile_active;
+static int     profile_checked;
 
 /*
  * Function name: add_hook
@@ -75,7 +85,11 @@ remove_hook(string name, mixed callback)
  * Function name: call_hook
  * Description  : Calls all the function which have registered themselves
  *                as listening to a specific hook.
- *                Any runtime errors from the hooks will be caught.
+ *                Any runtime errors from the hooks will be caught. A failing
+ *                callback does not stop the others from being called.
+ *                When hook profiling is on, see HOOK_PROFILER, the cost of
+ *                each callback is recorded. Whether it is on is asked at
+ *                most once every PROFILE_CHECK seconds.
  *
  * Example      : call_hook(HOOK_PLAYER_MOVED, source, dest);
  *
@@ -86,29 +100,60 @@ remove_hook(string name, mixed callback)
 void
 call_hook(string name, ...)
 {
+    object profiler;
+    mixed  error;
+    int    failed;
+    int    cost;
+
     if (!hooks[name] || !sizeof(hooks[name]))
         return;
 
-    try {
-        foreach (function callback: hooks[name])
+    /* Only ask the profiler every few seconds, it is usually off. */
+    if (time() >= profile_checked + PROFILE_CHECK)
+    {
+        profile_checked = time();
+        profile_active = (objectp(profiler = find_object(HOOK_PROFILER)) &&
+            profiler->query_active());
+    }
+    profiler = (profile_active ? find_object(HOOK_PROFILER) : 0);
+
+    foreach (function callback: hooks[name])
+    {
+        if (!functionp(callback))
         {
-            if (!functionp(callback))
-            {
-                hooks[name] -= ({ callback });
-                continue;
-            }
+            hooks[name] -= ({ callback });
+            continue;
+        }
+
+        if (profiler)
+        {
+            cost = EVAL_COST;
+        }
 
+        failed = 0;
+        try {
             applyv(callback, argv);
+        } catch (mixed err) {
+            error = err;
+            failed = 1;
         }
-    } catch (mixed err) {
-        write("Your sensitive mind notices a wrongness in the fabric of space.");
 
-        if (this_interactive()->query_wiz_level() ||
-            this_interactive()->query_prop(PLAYER_I_SEE_ERRORS))
+        if (profiler)
         {
-            this_interactive()->catch_tell("\n\n" + err + "\n");
-            return;
+            cost = EVAL_COST - cost;
+            profiler->record_hook(name,
+                MASTER_OB(function_object(callback)), cost, failed);
         }
     }
-}
 
+    if (!error)
+        return;
+
+    write("Your sensitive mind notices a wrongness in the fabric of space.");
+
+    if (this_interactive()->query_wiz_level() ||
+        this_interactive()->query_prop(PLAYER_I_SEE_ERRORS))
+    {
+        this_interactive()->catch_tell("\n\n" + error + "\n");
+    }
+}
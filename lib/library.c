@@ -778,6 +778,24 @@ library_move_book(string book_file, string new_dir)
     return rename(book_file, get_book_name(new_dir));
 }
 
+/*
+ * Function name: query_book_line
+ * Description:   Given a book file, return one of the first lines. They are
+ *                kept by the document index, so the file is not read again
+ *                until it changes.
+ * Arguments:     string file - The filename for the desired book
+ *                int line    - The line, TITLE_LINE, SUMMARY_LINE or
+ *                              AUTHOR_LINE
+ * Returns:       The line, or an empty string
+ */
+public string
+query_book_line(string file, int line)
+{
+    string *lines = DOC_INDEX->query_header(file);
+
+    return ((sizeof(lines) >= line) ? lines[line - 1] : "");
+}
+
 /*
  * Function name: query_book_title
  * Description:   Given a book file, return the book's title
@@ -787,7 +805,7 @@ library_move_book(string book_file, string new_dir)
 public string
 query_book_title(string file)
 {
-    string str = read_file(file, TITLE_LINE, 1);
+    string str = query_book_line(file, TITLE_LINE);
 
     /* remove trailing "\n" */
     if (strlen(str) && (str[-1..] == "\n"))
@@ -808,7 +826,7 @@ query_book_title(string file)
 public string
 query_book_author(string file)
 {
-    string str = read_file(file, AUTHOR_LINE, 1);
+    string str = query_book_line(file, AUTHOR_LINE);
 
     /* remove trailing "\n" */
     if (strlen(str) && (str[-1..] == "\n"))
@@ -829,7 +847,7 @@ query_book_author(string file)
 public string
 query_book_summary(string file)
 {
-    string str = read_file(file, SUMMARY_LINE, 1);
+    string str = query_book_line(file, SUMMARY_LINE);
 
     /* remove trailing "\n" */
     if (strlen(str) && (str[-1..] == "\n"))
@@ -867,7 +885,7 @@ get_books(string dir)
     setuid();
     seteuid(getuid());
 
-    books = map(get_dir(dir), &operator(+)(dir));
+    books = map(DOC_INDEX->query_files(dir), &operator(+)(dir));
 
     /* Any non-empty file is counted as a book */
     books = filter(books, &operator(>)(,0) @ file_size);
@@ -15,6 +15,18 @@
  *       store_update(obj);
  *   }
  *
+ * The store keeps an index of its items. If you also add the following
+ * function, items that leave the store are removed from the index at once.
+ * Without it, items that left are found and removed from the index when
+ * their entries are looked at during a sale.
+ *
+ *   public void
+ *   leave_inv(object obj, object to)
+ *   {
+ *       ::leave_inv(obj, to);
+ *       store_leave(obj);
+ *   }
+ *
  * It is also possible to give the store a default stock, that will be
  * replenished every time the room resets. Do enable this, add the following
  * function to your store room, and use the function set_default_stock() to
@@ -45,12 +57,34 @@
 #define	MAX_IDENTICAL (10)
 #define MAX_DEFAULT   (10)
 
+#define ENTRY_ITEM        (0)
+#define ENTRY_FINGERPRINT (1)
+#define ENTRY_MASTER      (2)
+
 static int     max_items      = MAX_ITEMS;
 static int     max_identical  = MAX_IDENTICAL;
 static int     stock_alarm_id = 0;
 static object *remove_list    = ({ });
 static mixed   default_stock  = ({ });
 
+/*
+ * store_entries - ({ ({ (object)item, (string)fingerprint, (string)master }) })
+ *                 The items in the order they arrived. When an item leaves,
+ *                 the fingerprint of its entry is cleared.
+ * store_items   - ([ (object)item : (mixed *)entry ])
+ * store_index   - ([ (string)fingerprint : (object *)items, oldest first ])
+ * store_stock   - ([ (string)master : (int)number in store ]) for the
+ *                 masters in the default stock.
+ * stock_masters - ([ (string)master : (int)default number ])
+ * store_count   - the number of items in the index.
+ */
+static mixed  *store_entries  = ({ });
+static mapping store_items    = ([ ]);
+static mapping store_index    = ([ ]);
+static mapping store_stock    = ([ ]);
+static mapping stock_masters  = ([ ]);
+static int     store_count    = 0;
+
 /*
  * Function name: set_max_items
  * Description  : Set the maximum number of items allowed in this store. This
@@ -122,6 +156,154 @@ set_max_values(int items, int identical)
     set_max_identical(identical);
 }
 
+/*
+ * Function name: store_fingerprint
+ * Description  : Gives the identity of an item. Two items are identical if
+ *                they have the same master object and the same short and
+ *                long description as set. The descriptions are not
+ *                evaluated, so VBFC in them is not resolved and does not
+ *                depend on an observer.
+ * Arguments    : object obj - the item.
+ * Returns      : string - the fingerprint.
+ */
+static string
+store_fingerprint(object obj)
+{
+    mixed short_desc = obj->query_short();
+    mixed long_desc = obj->query_long();
+
+    return MASTER_OB(obj) + "\n" +
+        (stringp(short_desc) ? short_desc : "") + "\n" +
+        (stringp(long_desc) ? long_desc : "");
+}
+
+/*
+ * Function name: store_register
+ * Description  : Adds an item to the index of the store.
+ * Arguments    : object obj - the item.
+ *                string fingerprint - the fingerprint, if already known.
+ */
+static void
+store_register(object obj, string fingerprint = 0)
+{
+    mixed *entry;
+    string master;
+
+    if (store_items[obj])
+    {
+        return;
+    }
+
+    if (!fingerprint)
+    {
+        fingerprint = store_fingerprint(obj);
+    }
+
+    master = MASTER_OB(obj);
+    entry = ({ obj, fingerprint, master });
+    store_items[obj] = entry;
+    store_entries += ({ entry });
+    store_index[fingerprint] = (pointerp(store_index[fingerprint]) ?
+        store_index[fingerprint] : ({ })) + ({ obj });
+    if (stock_masters[master])
+    {
+        store_stock[master]++;
+    }
+    store_count++;
+}
+
+/*
+ * Function name: store_forget
+ * Description  : Removes an entry from the index of the store.
+ * Arguments    : mixed *entry - the entry of the item.
+ */
+static void
+store_forget(mixed *entry)
+{
+    string fingerprint = entry[ENTRY_FINGERPRINT];
+
+    if (!fingerprint)
+    {
+        return;
+    }
+
+    /* A destructed item shows as 0. */
+    store_index[fingerprint] -= ({ entry[ENTRY_ITEM], 0 });
+    if (!sizeof(store_index[fingerprint]))
+    {
+        m_delkey(store_index, fingerprint);
+    }
+
+    if (stock_masters[entry[ENTRY_MASTER]])
+    {
+        store_stock[entry[ENTRY_MASTER]]--;
+    }
+
+    if (objectp(entry[ENTRY_ITEM]))
+    {
+        m_delkey(store_items, entry[ENTRY_ITEM]);
+    }
+
+    entry[ENTRY_FINGERPRINT] = 0;
+    store_count--;
+}
+
+/*
+ * Function name: store_present
+ * Description  : Finds out whether the item of an entry is still here.
+ * Arguments    : mixed *entry - the entry of the item.
+ * Returns      : int 1/0 - true if the item is in the store.
+ */
+static int
+store_present(mixed *entry)
+{
+    return (objectp(entry[ENTRY_ITEM]) &&
+        (environment(entry[ENTRY_ITEM]) == this_object()));
+}
+
+/*
+ * Function name: store_compact
+ * Description  : Removes the cleared entries from the list of entries.
+ */
+static void
+store_compact()
+{
+    store_entries = filter(store_entries,
+        &operator([])(, ENTRY_FINGERPRINT));
+}
+
+/*
+ * Function name: store_validate
+ * Description  : Removes all items from the index that are no longer in the
+ *                store. A sale only checks the entries it looks at, this is
+ *                done on reset.
+ */
+static void
+store_validate()
+{
+    foreach(mixed *entry: store_entries)
+    {
+        if (entry[ENTRY_FINGERPRINT] && !store_present(entry))
+        {
+            store_forget(entry);
+        }
+    }
+
+    store_compact();
+}
+
+/*
+ * Function name: store_discard
+ * Description  : Marks the item of an entry for removal.
+ * Arguments    : mixed *entry - the entry of the item.
+ */
+static void
+store_discard(mixed *entry)
+{
+    remove_list += ({ entry[ENTRY_ITEM] });
+    store_forget(entry);
+}
+
 /*
  * Function name: store_remove_items
  * Description  : Called with a little delay to actually remove items from
@@ -142,14 +324,20 @@ store_remove_items()
 /*
  * Function name: store_update
  * Description  : Update the contents of the storeroom, remove excess items.
+ *                Only the items identical to the new item and the oldest
+ *                items in the store are looked at.
  * Arguments    : object obj - the object that is added to the store.
  */
 void 
 store_update(object obj)
 {
-    int inv_size;
-    object *inv;
-    object *identical = ({ });
+    int index;
+    int size;
+    int excess;
+    string fingerprint;
+    object *identical;
+    object *inventory;
+    mixed *entry;
 
     /* Livings are not a part of the store inventory. */
     if (living(obj))
@@ -163,36 +351,82 @@ store_update(object obj)
         obj->extinguish_me();
     }
 
-    inv = FILTER_DEAD(all_inventory(this_object()) - ({ obj }) - remove_list);
+    /* An item that comes back is registered again, as it may have
+     * changed while it was away. */
+    if (pointerp(entry = store_items[obj]))
+    {
+        store_forget(entry);
+    }
 
-    if (max_identical)
+    fingerprint = store_fingerprint(obj);
+    if (max_identical &&
+        pointerp(identical = store_index[fingerprint]))
     {
-        /* We find two items identical if their long descriptions are
-         * identical.
-         */
-        identical = filter(inv, &operator(==)(obj->long()) @ &->long());
-        if (sizeof(identical) >= max_identical)
+        /* Forget the identical items that left without store_leave(),
+         * then remove the oldest of those that are left. */
+        foreach(object item: identical - ({ obj, 0 }))
         {
-            remove_list += identical[..(sizeof(identical) - max_identical)];
-            inv -= remove_list;
+            if ((environment(item) != this_object()) &&
+                pointerp(entry = store_items[item]))
+            {
+                store_forget(entry);
+            }
         }
-    }
 
-    inv_size = sizeof(inv);
-    if (inv_size >= max_items)
-    {
-        /* Remove excess items, but don't remove items that belong to the
-         * default stock. */
-        foreach (object item : inv)
+        identical = (pointerp(store_index[fingerprint]) ?
+            (store_index[fingerprint] - ({ obj, 0 })) : ({ }));
+        index = -1;
+        size = sizeof(identical) - max_identical;
+        while(++index <= size)
         {
-            if ((inv_size-- >= max_items) &&
-                !IN_ARRAY(MASTER_OB(item), default_stock))
+            if (pointerp(entry = store_items[identical[index]]))
             {
-                remove_list += ({ item });
+                store_discard(entry);
             }
         }
     }
 
+    store_register(obj, fingerprint);
+
+    /* Remove the oldest excess items, but don't remove items that belong
+     * to the default stock. The index may still hold items that left
+     * without store_leave(), so the excess is taken from the inventory.
+     * Those items are forgotten on the way, until the index is no larger
+     * than the store may hold. */
+    if (store_count > max_items)
+    {
+        inventory = all_inventory(this_object());
+        excess = sizeof(inventory - remove_list) -
+            sizeof(FILTER_LIVE(inventory)) - max_items;
+    }
+
+    index = -1;
+    size = sizeof(store_entries);
+    while (((excess > 0) || (store_count > max_items)) && (++index < size))
+    {
+        entry = store_entries[index];
+        if (!entry[ENTRY_FINGERPRINT] ||
+            (entry[ENTRY_ITEM] == obj))
+        {
+            continue;
+        }
+
+        if (!store_present(entry))
+        {
+            store_forget(entry);
+        }
+        else if ((excess > 0) && !stock_masters[entry[ENTRY_MASTER]])
+        {
+            store_discard(entry);
+            excess--;
+        }
+    }
+
+    if (size > (2 * store_count) + max_items)
+    {
+        store_compact();
+    }
+
     /* Items targetted for removal? */
     if (!stock_alarm_id && sizeof(remove_list))
     {
@@ -200,6 +434,34 @@ store_update(object obj)
     }
 }
 
+/*
+ * Function name: store_leave
+ * Description  : Removes an item that leaves the store from the index.
+ *                Call this from leave_inv() in the store.
+ * Arguments    : object obj - the object that leaves the store.
+ */
+void
+store_leave(object obj)
+{
+    mixed *entry;
+
+    if (pointerp(entry = store_items[obj]))
+    {
+        store_forget(entry);
+    }
+}
+
+/*
+ * Function name: query_store_count
+ * Description  : Gives the number of items in the index of the store.
+ * Returns      : int - the number of items.
+ */
+int
+query_store_count()
+{
+    return store_count;
+}
+
 /*
  * Function name: set_default_stock
  * Descripton   : Set the default stock for this store room. Every time the
@@ -225,6 +487,7 @@ set_default_stock(mixed stock)
 {
     int index;
 
+    stock_masters = ([ ]);
     index = sizeof(stock);
     while((index -= 2) >= 0)
     {
@@ -239,9 +502,21 @@ set_default_stock(mixed stock)
         {
             stock[index + 1] = MAX_DEFAULT;
         }
+
+        stock_masters[stock[index]] = stock[index + 1];
     }
 
     default_stock = stock;
+
+    /* Count the items of the new default stock. */
+    store_stock = ([ ]);
+    foreach(mixed *entry: store_entries)
+    {
+        if (entry[ENTRY_FINGERPRINT] && stock_masters[entry[ENTRY_MASTER]])
+        {
+            store_stock[entry[ENTRY_MASTER]]++;
+        }
+    }
 }
 
 /*
@@ -267,11 +542,18 @@ reset_store()
     int size  = sizeof(default_stock);
     int total;
     int counted;
-    object *inv;
+    object ob;
+
+    /* Add items that entered without passing store_update(). */
+    store_validate();
+    foreach(object item: all_inventory())
+    {
+        if (!living(item))
+        {
+            store_register(item);
+        }
+    }
 
-    inv = all_inventory();
-    inv -= FILTER_PLAYERS(inv);
-    
     /* For each of the items in the default stock, check the amount of items
      * in stock and clone new items if necessary.
      */
@@ -280,13 +562,13 @@ reset_store()
         total = ((default_stock[index + 1] == 1) ? default_stock[index + 1] :
             (default_stock[index + 1] - 1 + random(3)));
 
-        counted = sizeof(filter(inv, &operator(==)(default_stock[index]) @
-                             &extract(, 0, (strlen(default_stock[index]) - 1)) @
-                             file_name));
+        counted = store_stock[default_stock[index]];
         
         while(++counted <= total)
         {
-            clone_object(default_stock[index])->move(this_object(), 1);
+            ob = clone_object(default_stock[index]);
+            ob->move(this_object(), 1);
+            store_register(ob);
         }
     }
 }
@@ -386,6 +386,23 @@ money_merge(int *arr)
     return v;
 }
 
+/*
+ * Function name: coin_heap
+ * Description:   Finds the heap of coins of a type in an object, through the
+ *                coin ledger if the object is a container.
+ * Arguments:     ob - the object to search
+ *                str - the coin type
+ * Returns:       The coins object or 0.
+ */
+static object
+coin_heap(object ob, string str)
+{
+    if (function_exists("query_coin_heap", ob))
+	return ob->query_coin_heap(str);
+
+    return present(str + " coin", ob);
+}
+
 /*
  * Function name: what_coins
  * Description:   Finds out what of the cointypes a certain object contains.
@@ -406,7 +423,7 @@ what_coins(object ob)
 
     for (i = 0; i < num_of_types; i++)
     {
-        cn = present(ctypes[i] + " coin", ob);
+        cn = coin_heap(ob, ctypes[i]);
         if (!cn)
         {
             nums[i] = 0;
@@ -668,7 +685,7 @@ money_move(string str, int num, object from, object to)
 
     if (from)
     {
-	cf = present(str + " coin", from);
+	cf = coin_heap(from, str);
 	if (cf && function_exists("create_heap", cf) != "/std/coins")
 	    cf = 0;
     }
@@ -713,7 +730,7 @@ money_move(string str, int num, object from, object to)
 varargs int
 change_money(int *arr, object from, object to, int silent)
 {
-    int i, error1, error2, move_error;
+    int i, error1, error2, move_error, standard, paid;
 
     move_error = 0;
 
@@ -721,7 +738,13 @@ change_money(int *arr, object from, object to, int silent)
     if (sizeof(arr) != num_of_types * 2)
 	return -10;
 
-    for (i = 0; i < num_of_types; i++) /* Get money from the buyer. */
+    /* With the normal coin types all coins of a part of the deal are moved
+     * at once. Only when that fails do we move them type by type below.
+     */
+    standard = (implode(money_types, ",") == implode(MONEY_TYPES, ","));
+    paid = (standard && !MONEY_TRANSFER(arr[..(num_of_types - 1)], from, to));
+
+    for (i = 0; !paid && (i < num_of_types); i++) /* Get money from the buyer. */
 	if (arr[i] && (error1 = money_move(money_types[i],
 		 arr[i], from, to)))
 	{
@@ -741,6 +764,9 @@ change_money(int *arr, object from, object to, int silent)
 	    }
 	}
 
+    if (standard && !MONEY_TRANSFER(arr[num_of_types..], to, from))
+	return 0;
+
     for (i = num_of_types; i < 2 * num_of_types; i++)
 	if (arr[i] && (error1 = money_move(money_types[i - num_of_types],
 		 arr[i], to, from)) && from)
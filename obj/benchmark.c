@@ -0,0 +1,1040 @@
+/*
+ * /obj/benchmark.c
+ *
+ * Micro benchmarks for mudlib library code that does not have a daemon of
+ * its own to hold them. Each benchmark builds its own test objects, measures
+ * the evaluation cost and the cpu time, cleans up and returns a report.
+ * Call them from a wizard tool, for example:
+ *
+ *     Call /obj/benchmark benchmark_cooldowns 500%%50
+ *
+ * The cpu time is the user and system time of the whole game, as given by
+ * the driver in milliseconds. It is only meaningful for runs that are long
+ * enough. gettimeofday() is of no use here, as it only changes once every
+ * heartbeat.
+ *
+ * Mind that large arguments may exceed the evaluation cost limit. Benchmarks
+ * that run in chunks, with run_chunks(), report to the wizard who started
+ * them when done.
+ */
+
+#pragma no_clone
+#pragma no_inherit
+#pragma save_binary
+#pragma strict_types
+
+#include <composite.h>
+#include <files.h>
+#include <macros.h>
+#include <money.h>
+#include <ss_types.h>
+#include <std.h>
+#include <tasks.h>
+
+#define BENCHMARK_STORE ("/obj/benchmark_store")
+
+/*
+ * The number of livings whose cooldowns are handled in one evaluation.
+ */
+#define COOLDOWN_CHUNK (5)
+
+/*
+ * The number of task resolutions done in one evaluation.
+ */
+#define TASK_CHUNK   (2000)
+
+/*
+ * The number of buy and sell cycles done in one evaluation, and the number
+ * of other items the traders carry.
+ */
+#define MONEY_CHUNK  (250)
+#define MONEY_ITEMS  (40)
+
+/*
+ * The number of ip numbers checked against the sitebans in one evaluation.
+ */
+#define SITEBAN_CHUNK (20)
+
+/*
+ * A measurement, see measure_start() and measure_stop().
+ */
+#define MEASURE_COST  (0)   /* The evaluation cost. */
+#define MEASURE_CPU   (1)   /* The cpu time in milliseconds. */
+
+/*
+ * The state of a benchmark that runs in chunks, see run_chunks().
+ */
+#define RUN_WIZARD    (0)   /* The wizard to report to. */
+#define RUN_LEFT      (1)   /* The number of operations still to do. */
+#define RUN_CHUNK     (2)   /* The number of operations per evaluation. */
+#define RUN_STEP      (3)   /* int step(int count, mapping totals) */
+#define RUN_REPORT    (4)   /* string report(mapping totals) */
+#define RUN_TOTALS    (5)   /* ([ (string) label : (int *) measurement ]) */
+
+/*
+ * The alarm and the last update time of the old cooldown code, see
+ * legacy_cooldown_state().
+ */
+static int   legacy_alarm;
+static float legacy_time;
+
+/*
+ * Function name: create
+ * Description  : Constructor.
+ */
+public void
+create()
+{
+    setuid();
+    seteuid(getuid());
+}
+
+/*
+ * Function name: cpu_time
+ * Description  : Gives the cpu time used by the game.
+ * Returns      : int - the user and system time in milliseconds.
+ */
+static int
+cpu_time()
+{
+    int *usage = map(explode(SECURITY->do_debug("rusage"), " "), atoi);
+
+    return usage[0] + usage[1];
+}
+
+/*
+ * Function name: measure_start
+ * Description  : Starts a measurement.
+ * Returns      : int * - the mark to pass to measure_stop().
+ */
+static int *
+measure_start()
+{
+    int cpu = cpu_time();
+
+    return ({ EVAL_COST, cpu });
+}
+
+/*
+ * Function name: measure_stop
+ * Description  : Ends a measurement.
+ * Arguments    : int *mark - the mark from measure_start().
+ * Returns      : int * - the evaluation cost and cpu time, see MEASURE_*.
+ */
+static int *
+measure_stop(int *mark)
+{
+    int cost = EVAL_COST - mark[MEASURE_COST];
+
+    return ({ cost, cpu_time() - mark[MEASURE_CPU] });
+}
+
+/*
+ * Function name: measure_add
+ * Description  : Ends a measurement and adds it to the totals of a label.
+ * Arguments    : mapping totals - ([ (string) label : (int *) measurement ])
+ *                string label - what was measured.
+ *                int *mark - the mark from measure_start().
+ */
+static void
+measure_add(mapping totals, string label, int *mark)
+{
+    int *result = measure_stop(mark);
+
+    if (!pointerp(totals[label]))
+    {
+        totals[label] = ({ 0, 0 });
+    }
+
+    totals[label][MEASURE_COST] += result[MEASURE_COST];
+    totals[label][MEASURE_CPU] += result[MEASURE_CPU];
+}
+
+/*
+ * Function name: format_result
+ * Description  : Formats one line of a benchmark report.
+ * Arguments    : string label - what was measured.
+ *                int count    - the number of operations.
+ *                int *result  - the measurement, see MEASURE_*.
+ * Returns      : string - the line.
+ */
+static string
+format_result(string label, int count, int *result)
+{
+    if (!pointerp(result))
+    {
+        result = ({ 0, 0 });
+    }
+
+    return sprintf("%-20s %8d ops, eval %10d (%6d/op), cpu %7d ms\n",
+        label, count, result[MEASURE_COST],
+        (count ? (result[MEASURE_COST] / count) : 0), result[MEASURE_CPU]);
+}
+
+/*
+ * Function name: run_chunks
+ * Description  : Runs one chunk of a benchmark and schedules the next, or
+ *                reports when all is done. The step does the work of one
+ *                chunk and adds its measurements to the totals. It returns
+ *                0 when the benchmark cannot go on, for example because its
+ *                objects were destructed.
+ * Arguments    : mixed *run - the state of the benchmark, see RUN_*.
+ */
+static void
+run_chunks(mixed *run)
+{
+    int    count = MIN(run[RUN_CHUNK], run[RUN_LEFT]);
+    string report;
+
+    if (!run[RUN_STEP](count, run[RUN_TOTALS]))
+    {
+        return;
+    }
+
+    if (run[RUN_LEFT] -= count)
+    {
+        set_alarm(0.0, 0.0, &run_chunks(run));
+        return;
+    }
+
+    /* The report also cleans up, so it is made even without a wizard. */
+    report = run[RUN_REPORT](run[RUN_TOTALS]);
+    if (objectp(run[RUN_WIZARD]))
+    {
+        tell_object(run[RUN_WIZARD], report);
+    }
+}
+
+/*
+ * Function name: start_chunks
+ * Description  : Starts a benchmark that runs in chunks. It reports to
+ *                this_interactive() when done.
+ * Arguments    : int count - the number of operations.
+ *                int chunk - the number of operations per evaluation.
+ *                function step - does one chunk, see run_chunks().
+ *                function report - makes the report from the totals.
+ */
+static void
+start_chunks(int count, int chunk, function step, function report)
+{
+    set_alarm(0.0, 0.0, &run_chunks(({ this_interactive(), max(1, count),
+        chunk, step, report, ([ ]) })));
+}
+
+/*
+ * Function name: legacy_cooldown_alarm
+ * Description  : The alarm of the old cooldown code. It does nothing here.
+ */
+static void
+legacy_cooldown_alarm()
+{
+}
+
+/*
+ * Function name: legacy_cooldown_state
+ * Description  : Walks all cooldowns of a living the way the cooldown code
+ *                did before the expiry heap, on every trigger and query.
+ *                The hooks are not called.
+ * Arguments    : mapping cooldowns - ([ key : ({ time left, callback }) ])
+ *                int schedule - if true, set the alarm again.
+ */
+static void
+legacy_cooldown_state(mapping cooldowns, int schedule)
+{
+    float now = gettimeofday();
+    float delta = (legacy_time ? (now - legacy_time) : 0.0);
+    float next = 600.0;
+    float left;
+
+    if (schedule && legacy_alarm)
+    {
+        remove_alarm(legacy_alarm);
+        legacy_alarm = 0;
+    }
+
+    foreach(string key, mixed cooldown: cooldowns)
+    {
+        cooldown[0] -= delta;
+        left = cooldown[0];
+        if (left <= 0.0)
+        {
+            m_delkey(cooldowns, key);
+        }
+        else if (left < next)
+        {
+            next = left;
+        }
+    }
+
+    legacy_time = now;
+    if (schedule)
+    {
+        legacy_alarm = set_alarm(next, 0.0, legacy_cooldown_alarm);
+    }
+}
+
+/*
+ * Function name: legacy_trigger_cooldown
+ * Description  : Triggers a cooldown the way the old cooldown code did.
+ * Arguments    : mapping cooldowns - the cooldowns of the living.
+ *                string key - the cooldown.
+ *                float duration - the duration.
+ * Returns      : int 1/0 - true if the cooldown was started or extended.
+ */
+static int
+legacy_trigger_cooldown(mapping cooldowns, string key, float duration)
+{
+    legacy_cooldown_state(cooldowns, 0);
+    if (pointerp(cooldowns[key]) && (duration < cooldowns[key][0]))
+    {
+        legacy_cooldown_state(cooldowns, 1);
+        return 0;
+    }
+
+    cooldowns[key] = ({ duration, 0 });
+    legacy_cooldown_state(cooldowns, 1);
+    return 1;
+}
+
+/*
+ * Function name: cooldowns_step
+ * Description  : Runs one chunk of the cooldown benchmark. The livings of
+ *                the chunk are cloned, used and removed again.
+ * Arguments    : string *keys - the cooldowns per living.
+ *                int livings - the number of livings in this chunk.
+ *                mapping totals - the measurements.
+ * Returns      : int 1 - the benchmark can always go on.
+ */
+static int
+cooldowns_step(string *keys, int livings, mapping totals)
+{
+    object  *obs = ({ });
+    mapping *legacy = ({ });
+    float   *durations = ({ });
+    int      index;
+    int      found;
+    int     *mark;
+
+    index = -1;
+    while(++index < livings)
+    {
+        obs += ({ clone_object(NPC_OBJECT) });
+        legacy += ({ ([ ]) });
+    }
+
+    foreach(string key: keys)
+    {
+        durations += ({ itof(60 + random(600)) });
+    }
+
+    mark = measure_start();
+    foreach(mapping cooldowns: legacy)
+    {
+        index = -1;
+        while(++index < sizeof(keys))
+        {
+            legacy_trigger_cooldown(cooldowns, keys[index], durations[index]);
+        }
+    }
+    measure_add(totals, "trigger (old)", mark);
+
+    mark = measure_start();
+    foreach(object ob: obs)
+    {
+        index = -1;
+        while(++index < sizeof(keys))
+        {
+            ob->trigger_cooldown(keys[index], durations[index]);
+        }
+    }
+    measure_add(totals, "trigger (heap)", mark);
+
+    mark = measure_start();
+    foreach(mapping cooldowns: legacy)
+    {
+        foreach(string key: keys)
+        {
+            legacy_cooldown_state(cooldowns, 0);
+            found += pointerp(cooldowns[key]);
+        }
+    }
+    measure_add(totals, "query (old)", mark);
+
+    mark = measure_start();
+    foreach(object ob: obs)
+    {
+        foreach(string key: keys)
+        {
+            found += ob->query_cooldown(key);
+        }
+    }
+    measure_add(totals, "query (heap)", mark);
+
+    mark = measure_start();
+    foreach(mapping cooldowns: legacy)
+    {
+        foreach(string key: keys)
+        {
+            legacy_trigger_cooldown(cooldowns, key, 1200.0);
+        }
+    }
+    measure_add(totals, "extend (old)", mark);
+
+    mark = measure_start();
+    foreach(object ob: obs)
+    {
+        foreach(string key: keys)
+        {
+            ob->trigger_cooldown(key, 1200.0);
+        }
+    }
+    measure_add(totals, "extend (heap)", mark);
+
+    if (legacy_alarm)
+    {
+        remove_alarm(legacy_alarm);
+        legacy_alarm = 0;
+    }
+    obs->remove_object();
+    return 1;
+}
+
+/*
+ * Function name: cooldowns_report
+ * Description  : Makes the report of the cooldown benchmark.
+ * Arguments    : int livings - the number of livings.
+ *                int count - the number of cooldowns per living.
+ *                mapping totals - the measurements.
+ * Returns      : string - the report.
+ */
+static string
+cooldowns_report(int livings, int count, mapping totals)
+{
+    string report = sprintf("Cooldowns: %d livings, %d cooldowns each\n",
+        livings, count);
+
+    foreach(string label: ({ "trigger (old)", "trigger (heap)", "query (old)",
+        "query (heap)", "extend (old)", "extend (heap)" }))
+    {
+        report += format_result(label, livings * count, totals[label]);
+    }
+
+    return report;
+}
+
+/*
+ * Function name: benchmark_cooldowns
+ * Description  : Compares triggering, querying and extending cooldowns on
+ *                livings that have many active cooldowns, with the expiry
+ *                heap and with the old code that walked all cooldowns of
+ *                the living every time. It runs in chunks and reports to
+ *                this_interactive() when done.
+ * Arguments    : int livings - the number of livings to use.
+ *                int count   - the number of cooldowns per living.
+ * Returns      : string - a note that the benchmark was started.
+ */
+public string
+benchmark_cooldowns(int livings = 500, int count = 50)
+{
+    string *keys = ({ });
+    int     index;
+
+    index = -1;
+    while(++index < count)
+    {
+        keys += ({ "_benchmark_cooldown_" + index });
+    }
+
+    livings = max(1, livings);
+    start_chunks(livings, COOLDOWN_CHUNK, &cooldowns_step(keys, , ),
+        &cooldowns_report(livings, count, ));
+
+    return sprintf("Cooldowns: started %d livings with %d cooldowns each.\n",
+        livings, count);
+}
+
+/*
+ * Function name: tasks_step
+ * Description  : Runs one chunk of the task benchmark.
+ * Arguments    : object living - the living that resolves the tasks.
+ *                mixed *list - the skill list.
+ *                mixed task - the compiled task.
+ *                int count - the number of resolutions of each kind.
+ *                mapping totals - the measurements.
+ * Returns      : int 1/0 - true if the benchmark can go on.
+ */
+static int
+tasks_step(object living, mixed *list, mixed task, int count, mapping totals)
+{
+    int  index;
+    int *mark;
+
+    if (!objectp(living))
+        return 0;
+
+    mark = measure_start();
+    index = -1;
+    while(++index < count)
+    {
+        living->find_drm(list);
+    }
+    measure_add(totals, "skill list", mark);
+
+    mark = measure_start();
+    index = -1;
+    while(++index < count)
+    {
+        living->find_drm(task);
+    }
+    measure_add(totals, "compiled", mark);
+
+    return 1;
+}
+
+/*
+ * Function name: tasks_report
+ * Description  : Makes the report of the task benchmark and cleans up.
+ * Arguments    : object living - the living that resolved the tasks.
+ *                mixed task - the compiled task.
+ *                int count - the number of resolutions of each kind.
+ *                mapping totals - the measurements.
+ * Returns      : string - the report.
+ */
+static string
+tasks_report(object living, mixed task, int count, mapping totals)
+{
+    string report = sprintf("Tasks: %d resolutions, drm %d\n", count,
+        living->find_drm(task)) +
+        format_result("skill list", count, totals["skill list"]) +
+        format_result("compiled", count, totals["compiled"]);
+
+    living->remove_object();
+    return report;
+}
+
+/*
+ * Function name: benchmark_tasks
+ * Description  : Compares resolving a skill list with resolving the same
+ *                list compiled with TASK_COMPILE. The list mixes skills,
+ *                stats, a group and weights. It runs in chunks and reports
+ *                to this_interactive() when done.
+ * Arguments    : int count - the number of resolutions of each kind.
+ * Returns      : string - a note that the benchmark was started.
+ */
+public string
+benchmark_tasks(int count = 1000000)
+{
+    object living = clone_object(NPC_OBJECT);
+    mixed *list = ({ SS_WEP_SWORD, SKILL_WEIGHT, 50, TS_DEX, SKILL_AVG,
+        TS_STR, TS_CON, SKILL_END, SKILL_WEIGHT, 200, SKILL_VALUE, 10,
+        SS_DEFENCE });
+    mixed  task = TASK_COMPILE(list);
+
+    living->set_base_stat(SS_STR, 60);
+    living->set_base_stat(SS_DEX, 80);
+    living->set_base_stat(SS_CON, 70);
+    living->set_skill(SS_WEP_SWORD, 50);
+    living->set_skill(SS_DEFENCE, 40);
+
+    count = max(1, count);
+    if (living->find_drm(list) != living->find_drm(task))
+    {
+        living->remove_object();
+        return "Tasks: the compiled task gives a different result.\n";
+    }
+
+    start_chunks(count, TASK_CHUNK, &tasks_step(living, list, task, , ),
+        &tasks_report(living, task, count, ));
+
+    return sprintf("Tasks: started %d resolutions of each kind.\n", count);
+}
+
+/*
+ * Function name: store_sales
+ * Description  : Sells items into a store room. After every third sale an
+ *                earlier item is bought back, so that items also leave.
+ * Arguments    : int hooked - if true, the store calls store_leave().
+ *                int count - the number of items to sell.
+ *                int kinds - the number of different items.
+ * Returns      : mixed * - ({ (int *) measurement, (int) items kept })
+ */
+static mixed *
+store_sales(int hooked, int count, int kinds)
+{
+    object  store = clone_object(BENCHMARK_STORE);
+    object  buyer = clone_object(ROOM_OBJECT);
+    object *obs = ({ });
+    int    *mark;
+    int     index;
+    int     kept;
+
+    store->set_hooked(hooked);
+    store->set_max_values(count, 10);
+
+    index = -1;
+    while(++index < count)
+    {
+        obs += ({ clone_object(OBJECT_OBJECT) });
+        obs[index]->set_name("item");
+        obs[index]->set_long("This is item number " + (index % kinds) + ".\n");
+    }
+
+    mark = measure_start();
+    index = -1;
+    while(++index < count)
+    {
+        obs[index]->move(store, 1);
+        if (!(index % 3) && objectp(obs[index / 2]))
+        {
+            obs[index / 2]->move(buyer, 1);
+        }
+    }
+    mark = measure_stop(mark);
+
+    kept = store->query_store_count();
+    (obs - ({ 0 }))->remove_object();
+    store->remove_object();
+    buyer->remove_object();
+    return ({ mark, kept });
+}
+
+/*
+ * Function name: benchmark_store
+ * Description  : Measures the cost of selling many items into a store room
+ *                with /lib/store_support, once in a store that calls
+ *                store_leave() and once in a store that does not. For
+ *                comparison it also measures the cost of finding identical
+ *                items by comparing the long descriptions of all items, as
+ *                the store used to do.
+ * Arguments    : int count - the number of items to sell.
+ *                int kinds - the number of different items.
+ * Returns      : string - the report.
+ */
+public string
+benchmark_store(int count = 300, int kinds = 40)
+{
+    object *obs = ({ });
+    mixed  *hooked;
+    mixed  *unhooked;
+    int     index;
+    int    *mark;
+
+    kinds = max(1, kinds);
+    hooked = store_sales(1, count, kinds);
+    unhooked = store_sales(0, count, kinds);
+
+    index = -1;
+    while(++index < count)
+    {
+        obs += ({ clone_object(OBJECT_OBJECT) });
+        obs[index]->set_name("item");
+        obs[index]->set_long("This is item number " + (index % kinds) + ".\n");
+    }
+
+    mark = measure_start();
+    foreach(object ob: obs)
+    {
+        filter(obs, &operator(==)(ob->long()) @ &->long());
+    }
+    mark = measure_stop(mark);
+    obs->remove_object();
+
+    return sprintf("Store: %d items of %d kinds sold, %d and %d kept\n",
+        count, kinds, hooked[1], unhooked[1]) +
+        format_result("sell (hooked)", count, hooked[0]) +
+        format_result("sell (unhooked)", count, unhooked[0]) +
+        format_result("long scan (old)", count, mark);
+}
+
+/*
+ * Function name: legacy_transfer
+ * Description  : Moves coins the way MONEY_MOVE_COIN_TYPES did before the
+ *                coin ledger: the inventory is searched for every type to
+ *                check the coins, and again for every type to move them.
+ * Arguments    : int *coins - the coins to move.
+ *                object from - where to take them.
+ *                object to - where to put them.
+ * Returns      : int - 0 on success, else an error.
+ */
+static int
+legacy_transfer(int *coins, object from, object to)
+{
+    object cf;
+    int    index;
+
+    index = -1;
+    while(++index < SIZEOF_MONEY_TYPES)
+    {
+        cf = present(MONEY_TYPES[index] + " coin", from);
+        if (coins[index] > (cf ? cf->num_heap() : 0))
+        {
+            return -1;
+        }
+    }
+
+    index = -1;
+    while(++index < SIZEOF_MONEY_TYPES)
+    {
+        if (!coins[index])
+        {
+            continue;
+        }
+
+        cf = present(MONEY_TYPES[index] + " coin", from);
+        if (coins[index] < cf->num_heap())
+        {
+            cf->split_heap(coins[index]);
+        }
+        if (cf->move(to))
+        {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/*
+ * Function name: money_step
+ * Description  : Runs one chunk of the money benchmark.
+ * Arguments    : object buyer - the living that buys.
+ *                object seller - the living that sells.
+ *                int *price - the price in coins.
+ *                mapping counts - ([ "failed" : (int) failed moves ])
+ *                int count - the number of buy and sell cycles of each kind.
+ *                mapping totals - the measurements.
+ * Returns      : int 1/0 - true if the benchmark can go on.
+ */
+static int
+money_step(object buyer, object seller, int *price, mapping counts,
+    int count, mapping totals)
+{
+    int  index;
+    int *mark;
+
+    if (!objectp(buyer) || !objectp(seller))
+        return 0;
+
+    mark = measure_start();
+    index = -1;
+    while(++index < count)
+    {
+        counts["failed"] += !!legacy_transfer(price, buyer, seller);
+        counts["failed"] += !!legacy_transfer(price, seller, buyer);
+    }
+    measure_add(totals, "present scan (old)", mark);
+
+    mark = measure_start();
+    index = -1;
+    while(++index < count)
+    {
+        counts["failed"] += !!MONEY_TRANSFER(price, buyer, seller);
+        counts["failed"] += !!MONEY_TRANSFER(price, seller, buyer);
+    }
+    measure_add(totals, "ledger transfer", mark);
+
+    return 1;
+}
+
+/*
+ * Function name: money_report
+ * Description  : Makes the report of the money benchmark and cleans up.
+ * Arguments    : object buyer - the living that bought.
+ *                object seller - the living that sold.
+ *                int *price - the price in coins.
+ *                mapping counts - ([ "failed" : (int) failed moves ])
+ *                int count - the number of buy and sell cycles of each kind.
+ *                mapping totals - the measurements.
+ * Returns      : string - the report.
+ */
+static string
+money_report(object buyer, object seller, int *price, mapping counts,
+    int count, mapping totals)
+{
+    string report = sprintf("Money: %d buy and sell cycles of %s, " +
+        "%d failed moves, buyer has %s\n", count, MONEY_TEXT(price),
+        counts["failed"], MONEY_TEXT(MONEY_COINS(buyer))) +
+        format_result("present scan (old)", count * 2,
+        totals["present scan (old)"]) +
+        format_result("ledger transfer", count * 2,
+        totals["ledger transfer"]);
+
+    deep_inventory(buyer)->remove_object();
+    deep_inventory(seller)->remove_object();
+    buyer->remove_object();
+    seller->remove_object();
+    return report;
+}
+
+/*
+ * Function name: benchmark_money
+ * Description  : Compares moving coins by searching the inventory, as the
+ *                money code used to do, with MONEY_TRANSFER through the coin
+ *                ledger. Two livings that carry other items as well buy and
+ *                sell to each other at a price paid in all coin types. It
+ *                runs in chunks and reports to this_interactive() when done.
+ * Arguments    : int count - the number of buy and sell cycles of each kind.
+ * Returns      : string - a note that the benchmark was started.
+ */
+public string
+benchmark_money(int count = 10000)
+{
+    object  buyer = clone_object(NPC_OBJECT);
+    object  seller = clone_object(NPC_OBJECT);
+    int    *price = ({ 7, 5, 3, 1 });
+    mapping counts = ([ "failed" : 0 ]);
+    int     index;
+
+    buyer->set_name("buyer");
+    seller->set_name("seller");
+
+    index = -1;
+    while(++index < MONEY_ITEMS)
+    {
+        clone_object(OBJECT_OBJECT)->move(buyer, 1);
+        clone_object(OBJECT_OBJECT)->move(seller, 1);
+    }
+
+    index = -1;
+    while(++index < SIZEOF_MONEY_TYPES)
+    {
+        MONEY_MAKE(price[index] * 2, MONEY_TYPES[index])->move(buyer, 1);
+        MONEY_MAKE(price[index] * 2, MONEY_TYPES[index])->move(seller, 1);
+    }
+
+    count = max(1, count);
+    start_chunks(count, MONEY_CHUNK,
+        &money_step(buyer, seller, price, counts, , ),
+        &money_report(buyer, seller, price, counts, count, ));
+
+    return sprintf("Money: started %d buy and sell cycles of each kind.\n",
+        count);
+}
+
+/*
+ * Function name: random_ip
+ * Description  : Makes a random ip number, or one within a mask.
+ * Arguments    : string mask - the mask, like "10.1.*", or 0.
+ * Returns      : string - the ip number.
+ */
+static string
+random_ip(string mask = 0)
+{
+    string *parts = (stringp(mask) ? (explode(mask, ".") - ({ "*" })) : ({ }));
+
+    while(sizeof(parts) < 4)
+    {
+        parts += ({ "" + random(256) });
+    }
+
+    return implode(parts, ".");
+}
+
+/*
+ * Function name: sitebans_step
+ * Description  : Runs one chunk of the siteban benchmark.
+ * Arguments    : string *nologin - the masks that may not log in.
+ *                string *nonew - the masks that may not make characters.
+ *                mixed index - the siteban index of the master.
+ *                string *ips - all ip numbers to check.
+ *                mapping counts - ([ "done" : (int) ips checked,
+ *                    "banned" : (int) ips banned,
+ *                    "different" : (int) different results ])
+ *                int count - the number of ip numbers to check.
+ *                mapping totals - the measurements.
+ * Returns      : int 1 - the benchmark can always go on.
+ */
+static int
+sitebans_step(string *nologin, string *nonew, mixed index, string *ips,
+    mapping counts, int count, mapping totals)
+{
+    int  *legacy = ({ });
+    int  *indexed = ({ });
+    int  *mark;
+    int   pos;
+
+    ips = ips[counts["done"]..(counts["done"] + count - 1)];
+    counts["done"] += count;
+
+    mark = measure_start();
+    foreach(string ip: ips)
+    {
+        legacy += ({ (sizeof(filter(nologin, &wildmatch(, ip))) ?
+            SITEBAN_NOLOGIN : (sizeof(filter(nonew, &wildmatch(, ip))) ?
+            SITEBAN_NONEW : 0)) });
+    }
+    measure_add(totals, "wildmatch (old)", mark);
+
+    mark = measure_start();
+    foreach(string ip: ips)
+    {
+        indexed += ({ SECURITY->match_siteban_index(index, ip) });
+    }
+    measure_add(totals, "trie", mark);
+
+    pos = -1;
+    while(++pos < sizeof(ips))
+    {
+        counts["banned"] += !!indexed[pos];
+        counts["different"] += (indexed[pos] != legacy[pos]);
+    }
+
+    return 1;
+}
+
+/*
+ * Function name: sitebans_report
+ * Description  : Makes the report of the siteban benchmark.
+ * Arguments    : int ips - the number of ip numbers checked.
+ *                int masks - the number of masks.
+ *                mapping counts - see sitebans_step().
+ *                mapping totals - the measurements.
+ * Returns      : string - the report.
+ */
+static string
+sitebans_report(int ips, int masks, mapping counts, mapping totals)
+{
+    return sprintf("Sitebans: %d ips against %d masks, %d banned, " +
+        "%d different results\n", ips, masks, counts["banned"],
+        counts["different"]) +
+        format_result("wildmatch (old)", ips, totals["wildmatch (old)"]) +
+        format_result("trie", ips, totals["trie"]);
+}
+
+/*
+ * Function name: benchmark_sitebans
+ * Description  : Compares checking ip numbers against a large list of
+ *                sitebans with wildmatch(), as the master used to do, with
+ *                the octet trie the master builds of the sitebans. Half of
+ *                the ip numbers are taken from banned ranges. It runs in
+ *                chunks and reports to this_interactive() when done.
+ * Arguments    : int bans - the number of masks.
+ *                int count - the number of ip numbers to check.
+ * Returns      : string - a note that the benchmark was started.
+ */
+public string
+benchmark_sitebans(int bans = 5000, int count = 5000)
+{
+    mapping sitebans = ([ ]);
+    mapping counts = ([ "done" : 0, "banned" : 0, "different" : 0 ]);
+    string *ips = ({ });
+    string *masks;
+    string  mask;
+    int     index;
+
+    index = -1;
+    while(++index < bans)
+    {
+        switch(random(10))
+        {
+        case 0..1:
+            mask = implode(explode(random_ip(), ".")[..1], ".") + ".*";
+            break;
+
+        case 2..3:
+            mask = random_ip();
+            break;
+
+        default:
+            mask = implode(explode(random_ip(), ".")[..2], ".") + ".*";
+        }
+
+        sitebans[mask] = ({ (random(2) ? SITEBAN_NOLOGIN : SITEBAN_NONEW),
+            "benchmark", time(), "" });
+    }
+
+    masks = m_indices(sitebans);
+    count = max(1, count);
+    index = -1;
+    while(++index < count)
+    {
+        ips += ({ random_ip(random(2) ? masks[random(sizeof(masks))] : 0) });
+    }
+
+    start_chunks(count, SITEBAN_CHUNK, &sitebans_step(
+        filter(masks, &operator(==)(SITEBAN_NOLOGIN) @
+            &operator([])(, 0) @ &operator([])(sitebans, )),
+        filter(masks, &operator(==)(SITEBAN_NONEW) @
+            &operator([])(, 0) @ &operator([])(sitebans, )),
+        SECURITY->make_siteban_index(sitebans), ips, counts, , ),
+        &sitebans_report(count, sizeof(masks), counts, ));
+
+    return sprintf("Sitebans: started %d ips against %d masks.\n", count,
+        m_sizeof(sitebans));
+}
+
+/*
+ * Function name: benchmark_composite
+ * Description  : Measures describing an inventory of many similar items to
+ *                a number of observers with composite(), once with the
+ *                short descriptions reset before every observer, as if they
+ *                were not kept, and once with the kept short descriptions.
+ *                Then it changes the short of one item and checks that both
+ *                ways still give the same description. The observer is the
+ *                wizard who runs the benchmark.
+ * Arguments    : int count - the number of items.
+ *                int kinds - the number of different items.
+ *                int observers - the number of observers.
+ * Returns      : string - the report.
+ */
+public string
+benchmark_composite(int count = 200, int kinds = 20, int observers = 20)
+{
+    object  observer = this_interactive();
+    object *obs = ({ });
+    string *before = allocate(observers);
+    string *after = allocate(observers);
+    string  changed;
+    mapping totals = ([ ]);
+    int     index;
+    int     differ;
+    int    *mark;
+
+    kinds = max(1, kinds);
+    count = max(1, count);
+    index = -1;
+    while(++index < count)
+    {
+        obs += ({ clone_object(OBJECT_OBJECT) });
+        obs[index]->set_name("stone");
+        obs[index]->set_adj("kind" + (index % kinds));
+        obs[index]->set_short("kind" + (index % kinds) + " stone");
+        obs[index]->set_pshort("kind" + (index % kinds) + " stones");
+    }
+
+    index = -1;
+    while(++index < observers)
+    {
+        obs->reset_short_cache();
+        mark = measure_start();
+        before[index] = FO_COMPOSITE_DEAD(obs, observer);
+        measure_add(totals, "short reset (old)", mark);
+    }
+
+    index = -1;
+    while(++index < observers)
+    {
+        mark = measure_start();
+        after[index] = FO_COMPOSITE_DEAD(obs, observer);
+        measure_add(totals, "short kept", mark);
+    }
+
+    index = -1;
+    while(++index < observers)
+    {
+        differ += (before[index] != after[index]);
+    }
+
+    /* A changed short must show at once. */
+    obs[0]->set_short("changed stone");
+    changed = FO_COMPOSITE_DEAD(obs, observer);
+    obs->reset_short_cache();
+    differ += (changed != FO_COMPOSITE_DEAD(obs, observer));
+
+    obs->remove_object();
+    return sprintf("Composite: %d items of %d kinds to %d observers, " +
+        "%d differ.\n", count, kinds, observers, differ) +
+        format_result("short reset (old)", observers,
+        totals["short reset (old)"]) +
+        format_result("short kept", observers, totals["short kept"]);
+}
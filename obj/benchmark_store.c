@@ -0,0 +1,65 @@
+/*
+ * /obj/benchmark_store.c
+ *
+ * A store room used by benchmark_store() in /obj/benchmark.c. It can be
+ * told not to call store_leave(), to measure a store that does not.
+ */
+
+#pragma save_binary
+#pragma strict_types
+
+inherit "/std/room";
+inherit "/lib/store_support";
+
+static int hooked = 1;
+
+/*
+ * Function name: create_room
+ * Description  : Constructor.
+ */
+public void
+create_room()
+{
+    set_short("benchmark store");
+    set_long("This is the store room used by the benchmarks.\n");
+}
+
+/*
+ * Function name: set_hooked
+ * Description  : Sets whether the store calls store_leave().
+ * Arguments    : int flag - if true, it does.
+ */
+public void
+set_hooked(int flag)
+{
+    hooked = flag;
+}
+
+/*
+ * Function name: enter_inv
+ * Description  : Keeps the stock of the store in check.
+ * Arguments    : object obj - the object entering.
+ *                object from - where it came from.
+ */
+public void
+enter_inv(object obj, object from)
+{
+    ::enter_inv(obj, from);
+    store_update(obj);
+}
+
+/*
+ * Function name: leave_inv
+ * Description  : Keeps the index of the store up to date, if we should.
+ * Arguments    : object obj - the object leaving.
+ *                object to - where it goes.
+ */
+public void
+leave_inv(object obj, object to)
+{
+    ::leave_inv(obj, to);
+    if (hooked)
+    {
+        store_leave(obj);
+    }
+}
@@ -0,0 +1,637 @@
+/*
+ * /secure/combat_log.c
+ *
+ * This object keeps the log of all hits and misses in combat. The events
+ * are kept in memory, column by column, and written in blocks, so nothing
+ * has to be formatted for each hit. The log is rotated every hour and old
+ * logs are removed after a few days.
+ *
+ * A log file consists of blocks. Strings (files and hit locations) are
+ * written once per file and referred to by number. After a reboot a number
+ * may be given again, the last definition before a block applies:
+ *
+ *     #S <id> <string>
+ *     #B <rows> <time>
+ *     t <milliseconds since the time of the block> ...
+ *     a <attacker> ...      v <victim> ...      w <weapon> ...
+ *     p <pen> ...           d <dt> ...          h <hp> ...
+ *     m <dam> ...           l <hitloc> ...      i <aid> ...
+ *
+ * Attackers and victims are kept as "<master file>:<real name>", so that
+ * players with the same body are told apart while clones of an npc are
+ * counted together. Weapons are kept as their master file. These strings
+ * are made once per object for each block. The weapon of an attack is
+ * asked once per block as well, so a weapon wielded during a block is
+ * logged from the next block on.
+ *
+ * A block never spans two hours, so it is always written to the log of
+ * the hour its first event happened in.
+ *
+ * The wizard command 'combatlog' aggregates the log per weapon, attacker
+ * or victim.
+ */
+
+#pragma no_clone
+#pragma no_inherit
+#pragma save_binary
+#pragma strict_types
+
+#include <files.h>
+#include <macros.h>
+#include <std.h>
+#include <time.h>
+
+#define LOG_DIR       ("/syslog/log/combat/")
+#define BLOCK_ROWS    (256)     /* Rows in a block, flush when reached. */
+#define FLUSH_DELAY   (30.0)    /* Seconds before a partial block is written. */
+#define KEEP_TIME     (259200)  /* Seconds to keep old logs, three days. */
+#define MAX_HOURS     (24)      /* The most hours a query may read. */
+
+#define COL_TIME      (0)
+#define COL_ATTACKER  (1)
+#define COL_VICTIM    (2)
+#define COL_WEAPON    (3)
+#define COL_PEN       (4)
+#define COL_DT        (5)
+#define COL_HP        (6)
+#define COL_DAM       (7)
+#define COL_HITLOC    (8)
+#define COL_AID       (9)
+#define COLUMNS       ({ "t", "a", "v", "w", "p", "d", "h", "m", "l", "i" })
+#define COMBATANT(ob)  (MASTER_OB(ob) + ":" + (ob)->query_real_name())
+
+#define STRING_COLS   ({ COL_ATTACKER, COL_VICTIM, COL_WEAPON, COL_HITLOC })
+
+#define AGG_HITS      (0)
+#define AGG_MISSES    (1)
+#define AGG_DAMAGE    (2)
+#define AGG_FIRST     (3)
+#define AGG_LAST      (4)
+
+/*
+ * Global variables. They are not saved.
+ *
+ * buffer  - the events not written yet, one array per column.
+ * block_hour - the hour of the first event in the buffer.
+ * names   - ([ (object) combatant : (string) name ]) for the buffer.
+ * weapons - ([ (object) attacker : ([ (int) aid : (string) weapon ]) ])
+ *           for the buffer.
+ * file    - the log file being written.
+ * strings - ([ (string) string : (int) id ]) the strings in the file.
+ * new_strings - the lines for the strings added during a flush.
+ * rows, blocks, bytes, flush_cost - what was written since the reboot
+ *           and the eval cost of writing it.
+ */
+private static mixed  *buffer;
+private static int     block_hour;
+private static mapping names = ([ ]);
+private static mapping weapons = ([ ]);
+private static string  file;
+private static mapping strings = ([ ]);
+private static string *new_strings;
+private static int     flush_alarm;
+private static int     rows;
+private static int     blocks;
+private static int     bytes;
+private static int     flush_cost;
+
+/*
+ * Prototype.
+ */
+public void flush();
+
+/*
+ * Function name: clear_buffer
+ * Description  : Empties the buffer.
+ */
+static void
+clear_buffer()
+{
+    buffer = ({ });
+    foreach(string column: COLUMNS)
+    {
+        buffer += ({ ({ }) });
+    }
+    names = ([ ]);
+    weapons = ([ ]);
+}
+
+/*
+ * Function name: create
+ * Description  : Constructor.
+ */
+public void
+create()
+{
+    setuid();
+    seteuid(getuid());
+
+    clear_buffer();
+
+    if (file_size(LOG_DIR) != -2)
+    {
+        mkdir(LOG_DIR[..-2]);
+    }
+}
+
+/*
+ * Function name: log_file_name
+ * Description  : Gives the log file for a time, one for each hour.
+ * Arguments    : int when - the time.
+ * Returns      : string - the path of the log file.
+ */
+static string
+log_file_name(int when)
+{
+    return LOG_DIR + TIME2FORMAT(when, "yyyymmdd") + "-" +
+        ctime(when)[11..12];
+}
+
+/*
+ * Function name: add_hit
+ * Description  : Called from the combat object for every hit and miss. The
+ *                event is only stored. It is written in the next block.
+ * Arguments    : object attacker - the attacker.
+ *                object victim - the one who was attacked.
+ *                int pen - the penetration.
+ *                int dt - the damage type.
+ *                int hp - the hit points of the victim before the hit.
+ *                int dam - the damage done, 0 for a miss.
+ *                string hitloc - the description of the hit location.
+ *                int aid - the attack id.
+ */
+public void
+add_hit(object attacker, object victim, int pen, int dt, int hp, int dam,
+    string hitloc, int aid)
+{
+    mapping used;
+    mixed   weapon;
+    float   now;
+
+    if ((calling_program()[0..10] != "std/combat/") ||
+        !objectp(attacker) || !objectp(victim))
+    {
+        return;
+    }
+
+    now = gettimeofday();
+    if (sizeof(buffer[COL_TIME]) && (ftoi(now) / 3600 != block_hour))
+    {
+        flush();
+    }
+    if (!sizeof(buffer[COL_TIME]))
+    {
+        block_hour = ftoi(now) / 3600;
+    }
+
+    if (!names[attacker])
+    {
+        names[attacker] = COMBATANT(attacker);
+    }
+    if (!names[victim])
+    {
+        names[victim] = COMBATANT(victim);
+    }
+    if (!mappingp(used = weapons[attacker]))
+    {
+        used = weapons[attacker] = ([ ]);
+    }
+    if (!(weapon = used[aid]))
+    {
+        weapon = attacker->query_weapon(aid);
+        weapon = used[aid] = (objectp(weapon) ? MASTER_OB(weapon) : "-");
+    }
+
+    buffer[COL_TIME]     += ({ now });
+    buffer[COL_ATTACKER] += ({ names[attacker] });
+    buffer[COL_VICTIM]   += ({ names[victim] });
+    buffer[COL_WEAPON]   += ({ weapon });
+    buffer[COL_PEN]      += ({ pen });
+    buffer[COL_DT]       += ({ dt });
+    buffer[COL_HP]       += ({ hp });
+    buffer[COL_DAM]      += ({ dam });
+    buffer[COL_HITLOC]   += ({ (stringp(hitloc) ? hitloc : "-") });
+    buffer[COL_AID]      += ({ aid });
+
+    if (sizeof(buffer[COL_TIME]) >= BLOCK_ROWS)
+    {
+        flush();
+    }
+    else if (!flush_alarm)
+    {
+        flush_alarm = set_alarm(FLUSH_DELAY, 0.0, flush);
+    }
+}
+
+/*
+ * Function name: string_id
+ * Description  : Gives the number of a string in the current log file. A
+ *                new string gets a line to be written before the block.
+ * Arguments    : string str - the string.
+ * Returns      : int - the number.
+ */
+static int
+string_id(string str)
+{
+    int id;
+
+    if (!(id = strings[str]))
+    {
+        id = strings[str] = m_sizeof(strings) + 1;
+        new_strings += ({ "#S " + id + " " + str });
+    }
+
+    return id;
+}
+
+/*
+ * Function name: time_offset
+ * Description  : Gives the time of an event in milliseconds after a base.
+ * Arguments    : int base - the base time.
+ *                float when - the time of the event.
+ * Returns      : int - the offset.
+ */
+static int
+time_offset(int base, float when)
+{
+    return ftoi((when - itof(base)) * 1000.0);
+}
+
+/*
+ * Function name: remove_old_logs
+ * Description  : Removes the logs that are older than KEEP_TIME.
+ */
+static void
+remove_old_logs()
+{
+    string oldest = log_file_name(time() - KEEP_TIME)[strlen(LOG_DIR)..];
+
+    foreach(string name: get_dir(LOG_DIR) - ({ ".", ".." }))
+    {
+        if (name < oldest)
+        {
+            rm(LOG_DIR + name);
+        }
+    }
+}
+
+/*
+ * Function name: flush
+ * Description  : Writes the events in the buffer as a block to the log of
+ *                the hour of its first event. When that is not the file
+ *                written last, a new log file is started.
+ */
+public void
+flush()
+{
+    string *text = ({ });
+    string  name;
+    mixed  *values;
+    int     base;
+    int     cost = EVAL_COST;
+    int     column = -1;
+
+    if (flush_alarm)
+    {
+        remove_alarm(flush_alarm);
+        flush_alarm = 0;
+    }
+
+    if (!sizeof(buffer[COL_TIME]))
+    {
+        return;
+    }
+
+    base = ftoi(buffer[COL_TIME][0]);
+    if ((name = log_file_name(base)) != file)
+    {
+        file = name;
+        strings = ([ ]);
+        remove_old_logs();
+    }
+
+    new_strings = ({ });
+    while(++column < sizeof(COLUMNS))
+    {
+        if (column == COL_TIME)
+        {
+            values = map(buffer[column], &time_offset(base));
+        }
+        else if (IN_ARRAY(column, STRING_COLS))
+        {
+            values = map(buffer[column], string_id);
+        }
+        else
+        {
+            values = buffer[column];
+        }
+        text += ({ COLUMNS[column] + " " +
+            implode(map(values, &operator(+)("")), " ") });
+    }
+
+    name = implode(new_strings + ({ "#B " + sizeof(buffer[COL_TIME]) + " " +
+        base }) + text, "\n") + "\n";
+    write_file(file, name);
+
+    rows += sizeof(buffer[COL_TIME]);
+    blocks++;
+    bytes += strlen(name);
+    flush_cost += EVAL_COST - cost;
+    clear_buffer();
+}
+
+/*
+ * Function name: valid_user
+ * Description  : Only full wizards may query the log.
+ * Returns      : int 1/0 - true if allowed.
+ */
+static int
+valid_user()
+{
+    return (SECURITY->query_wiz_rank(this_interactive()->query_real_name())
+        >= WIZ_NORMAL);
+}
+
+/*
+ * Function name: add_event
+ * Description  : Adds one event to an aggregation.
+ * Arguments    : mapping agg - the aggregation, modified.
+ *                string key - the weapon, attacker or victim.
+ *                float when - the time of the event.
+ *                int dam - the damage done.
+ */
+static void
+add_event(mapping agg, string key, float when, int dam)
+{
+    mixed *entry;
+
+    if (!pointerp(entry = agg[key]))
+    {
+        entry = agg[key] = ({ 0, 0, 0, when, when });
+    }
+
+    if (dam > 0)
+    {
+        entry[AGG_HITS]++;
+        entry[AGG_DAMAGE] += dam;
+    }
+    else
+    {
+        entry[AGG_MISSES]++;
+    }
+
+    if (when < entry[AGG_FIRST])
+    {
+        entry[AGG_FIRST] = when;
+    }
+    if (when > entry[AGG_LAST])
+    {
+        entry[AGG_LAST] = when;
+    }
+}
+
+/*
+ * Function name: aggregate_block
+ * Description  : Adds a block read from a log to an aggregation.
+ * Arguments    : mixed *job - the query, see query_aggregate().
+ */
+static void
+aggregate_block(mixed *job)
+{
+    mixed  *cols = job[7];
+    string  key;
+    int     index = -1;
+    int     size = min(job[9], sizeof(cols[COL_DAM]));
+
+    while(++index < size)
+    {
+        key = job[6][atoi(cols[job[1]][index])];
+        /* Logs written before the real name was kept have clones. */
+        if ((job[1] != COL_WEAPON) && wildmatch("*#*", key))
+        {
+            key = explode(key + "#", "#")[0];
+        }
+        add_event(job[5], key,
+            itof(job[8]) + (itof(atoi(cols[COL_TIME][index])) / 1000.0),
+            atoi(cols[COL_DAM][index]));
+    }
+}
+
+/*
+ * Function name: sort_damage
+ * Description  : Sorts the rows of the report on damage, highest first.
+ */
+static int
+sort_damage(mixed *a, mixed *b)
+{
+    return b[AGG_DAMAGE + 1] - a[AGG_DAMAGE + 1];
+}
+
+/*
+ * Function name: sort_dps
+ * Description  : Sorts the rows of the report on damage per second, highest
+ *                first.
+ */
+static int
+sort_dps(mixed *a, mixed *b)
+{
+    return ((a[6] == b[6]) ? 0 : ((a[6] > b[6]) ? -1 : 1));
+}
+
+/*
+ * Function name: report_aggregate
+ * Description  : Tells the result of a query to the wizard who asked.
+ * Arguments    : mixed *job - the query, see query_aggregate().
+ */
+static void
+report_aggregate(mixed *job)
+{
+    mixed *lines = ({ });
+    string text;
+    int    index;
+
+    /* The events that were not written yet count as well. */
+    index = -1;
+    while(++index < sizeof(buffer[COL_TIME]))
+    {
+        add_event(job[5], ((job[1] == COL_WEAPON) ? buffer[job[1]][index] :
+            explode(buffer[job[1]][index] + "#", "#")[0]),
+            buffer[COL_TIME][index], buffer[COL_DAM][index]);
+    }
+
+    foreach(string key, mixed *entry: job[5])
+    {
+        lines += ({ ({ key }) + entry + ({ itof(entry[AGG_DAMAGE]) /
+            ((entry[AGG_LAST] - entry[AGG_FIRST] > 1.0) ?
+            (entry[AGG_LAST] - entry[AGG_FIRST]) : 1.0) }) });
+    }
+
+    if (!objectp(job[0]))
+    {
+        return;
+    }
+
+    if (!sizeof(lines))
+    {
+        tell_object(job[0], "There are no combat events in that period.\n");
+        return;
+    }
+
+    lines = sort_array(lines, (job[2] ? sort_dps : sort_damage))[..19];
+    text = sprintf("%-40s %7s %7s %9s %6s %7s\n", "Key", "Hits", "Misses",
+        "Damage", "Avg", "DPS");
+    foreach(mixed *row: lines)
+    {
+        text += sprintf("%-40s %7d %7d %9d %6d %7.1f\n",
+            ((strlen(row[0]) > 40) ? row[0][-40..] : row[0]),
+            row[AGG_HITS + 1], row[AGG_MISSES + 1], row[AGG_DAMAGE + 1],
+            (row[AGG_HITS + 1] ? (row[AGG_DAMAGE + 1] / row[AGG_HITS + 1]) :
+            0), row[6]);
+    }
+
+    job[0]->more(text);
+}
+
+/*
+ * Function name: aggregate_step
+ * Description  : Reads a part of the logs for a query and schedules the
+ *                next part, or reports when all is read.
+ * Arguments    : mixed *job - the query, see query_aggregate().
+ */
+static void
+aggregate_step(mixed *job)
+{
+    string  text;
+    string  str;
+    int     id;
+    int     index;
+
+    if (!sizeof(job[3]))
+    {
+        report_aggregate(job);
+        return;
+    }
+
+    if (!stringp(text = read_file(job[3][0], job[4], 200)))
+    {
+        job[3] = job[3][1..];
+        job[4] = 1;
+        job[6] = ([ ]);
+        set_alarm(0.0, 0.0, &aggregate_step(job));
+        return;
+    }
+
+    job[4] += 200;
+    foreach(string line: explode(text, "\n"))
+    {
+        if (line[0..1] == "#S")
+        {
+            if (sscanf(line, "#S %d %s", id, str) == 2)
+            {
+                job[6][id] = str;
+            }
+        }
+        else if (line[0..1] == "#B")
+        {
+            sscanf(line, "#B %d %d", job[9], job[8]);
+            job[7] = allocate(sizeof(COLUMNS));
+        }
+        else if (pointerp(job[7]) &&
+            ((index = member_array(line[0..0], COLUMNS)) != -1))
+        {
+            job[7][index] = explode(line[2..], " ");
+            if (index == COL_AID)
+            {
+                aggregate_block(job);
+                job[7] = 0;
+            }
+        }
+    }
+
+    set_alarm(0.0, 0.0, &aggregate_step(job));
+}
+
+/*
+ * Function name: query_aggregate
+ * Description  : Starts a query on the log. The logs are read in steps and
+ *                the result is told to this_interactive() when done.
+ * Arguments    : string by - "weapon", "attacker" or "victim".
+ *                int hours - the number of hours to read, 1 is this hour.
+ *                int dps - if true, sort on damage per second.
+ * Returns      : int 1/0 - success/failure.
+ */
+public int
+query_aggregate(string by, int hours, int dps)
+{
+    string *files = ({ });
+    int     column;
+
+    if (!valid_user() ||
+        ((column = member_array(by, ({ "attacker", "victim", "weapon" })))
+        == -1))
+    {
+        return 0;
+    }
+
+    column += COL_ATTACKER;
+    flush();
+
+    hours = max(1, min(hours, MAX_HOURS));
+    while(--hours >= 0)
+    {
+        files += ({ log_file_name(time() - (hours * 3600)) });
+    }
+    files = filter(files, &operator(<)(0) @ file_size);
+
+    /* ({ wizard, column, dps, files, line, aggregation, strings, block,
+     *    block time, block rows }) */
+    set_alarm(0.0, 0.0, &aggregate_step(({ this_interactive(), column, dps,
+        files, 1, ([ ]), ([ ]), 0, 0, 0 })));
+    return 1;
+}
+
+/*
+ * Function name: query_status
+ * Description  : Gives the state of the log.
+ * Returns      : string - the report.
+ */
+public string
+query_status()
+{
+    string *files = get_dir(LOG_DIR) - ({ ".", ".." });
+    int     size;
+
+    foreach(string name: files)
+    {
+        size += file_size(LOG_DIR + name);
+    }
+
+    return sprintf("Written: %d events in %d blocks, %d bytes, eval %d " +
+        "per event.\nBuffered: %d events.\nLogs: %d files, %d kB in %s, " +
+        "now writing %s.\n", rows, blocks, bytes,
+        (rows ? (flush_cost / rows) : 0), sizeof(buffer[COL_TIME]),
+        sizeof(files), size / 1024, LOG_DIR,
+        (stringp(file) ? file[strlen(LOG_DIR)..] : "nothing"));
+}
+
+/*
+ * Function name: remove_object
+ * Description  : Writes the buffer before we are destructed.
+ */
+public void
+remove_object()
+{
+    flush();
+    destruct();
+}
+
+/*
+ * Function name: query_prevent_shadow
+ * Description  : We do not want anyone shadowing this object.
+ * Returns      : int 1 - always.
+ */
+public nomask int
+query_prevent_shadow()
+{
+    return 1;
+}
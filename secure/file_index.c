@@ -0,0 +1,456 @@
+/*
+ * /secure/file_index.c
+ *
+ * This object keeps an index of the sizes and times of all files in the
+ * game, per directory, so that commands like du, tree and ls -l do not have
+ * to ask the driver for every file. The totals of a directory tree are
+ * computed from the index and kept until something in the tree changes.
+ *
+ * The master tells this object about every write it allows, through
+ * note_write(). The directory is then marked as changed and it is read
+ * again the next time it is asked for. A crawler that runs in small steps
+ * reads all directories again, oldest first, to catch what was changed
+ * outside the game.
+ *
+ * Only directories that have been read are in the index. When a directory
+ * is asked for that is not known yet, 0 is returned and the caller should
+ * read the disk itself.
+ */
+
+#pragma no_clone
+#pragma no_inherit
+#pragma save_binary
+#pragma strict_types
+
+#include <files.h>
+#include <macros.h>
+#include <std.h>
+#include <time.h>
+
+#define CRAWL_DELAY    (2.0)    /* Seconds between steps of the crawler. */
+#define CRAWL_EVAL     (50000)  /* The eval cost of a step of the crawler. */
+
+#define ENTRY_FILES    (0)
+#define ENTRY_CHECKED  (1)
+
+#define FILE_SIZE      (0)
+#define FILE_TIME      (1)
+
+#define SUBPATH(d, n)  (((d) == "/" ? "" : (d)) + "/" + (n))
+
+/*
+ * Global variables. They are not saved.
+ *
+ * index   - ([ (string) dir : ({ ([ (string) name : ({ (int) size,
+ *                                     (int) time }) ]), (int) checked }) ])
+ *           The size of a directory is -2.
+ * totals  - ([ (string) dir : ({ (int) bytes, (int) files }) ])
+ * dirty   - ([ (string) dir : 1 ]) directories that were written to.
+ * queue   - the directories the crawler still has to read in this pass.
+ * pass_*  - the start, the directories and files read in this pass.
+ * last_*  - the duration, directories and files of the last full pass.
+ */
+private static mapping index  = ([ ]);
+private static mapping totals = ([ ]);
+private static mapping dirty  = ([ ]);
+private static string *queue  = ({ "/" });
+private static int     pass_started;
+private static int     pass_dirs;
+private static int     pass_files;
+private static int     last_time;
+private static int     last_dirs;
+private static int     last_files;
+private static int     passes;
+
+/*
+ * Prototype.
+ */
+static void crawl();
+
+/*
+ * Function name: create
+ * Description  : Constructor. Starts the crawler.
+ */
+public void
+create()
+{
+    setuid();
+    seteuid(getuid());
+
+    pass_started = time();
+    set_alarm(CRAWL_DELAY, CRAWL_DELAY, crawl);
+}
+
+/*
+ * Function name: parent_dir
+ * Description  : Gives the directory a path is in.
+ * Arguments    : string path - the path.
+ * Returns      : string - the directory.
+ */
+static string
+parent_dir(string path)
+{
+    string *parts = explode(path, "/") - ({ "" });
+
+    if (sizeof(parts) <= 1)
+    {
+        return "/";
+    }
+
+    return "/" + implode(parts[..(sizeof(parts) - 2)], "/");
+}
+
+/*
+ * Function name: clean_path
+ * Description  : Gives a directory in the form used as key in the index,
+ *                without a trailing slash.
+ * Arguments    : string path - the directory.
+ * Returns      : string - the key.
+ */
+static string
+clean_path(string path)
+{
+    string *parts = explode(path, "/") - ({ "" });
+
+    return (sizeof(parts) ? ("/" + implode(parts, "/")) : "/");
+}
+
+/*
+ * Function name: invalidate
+ * Description  : Forgets the totals of a directory and all directories it
+ *                is in.
+ * Arguments    : string dir - the directory.
+ */
+static void
+invalidate(string dir)
+{
+    while (dir != "/")
+    {
+        m_delkey(totals, dir);
+        dir = parent_dir(dir);
+    }
+
+    m_delkey(totals, "/");
+}
+
+/*
+ * Function name: forget_dir
+ * Description  : Removes a directory and everything below it from the index.
+ * Arguments    : string dir - the directory.
+ */
+static void
+forget_dir(string dir)
+{
+    mixed *entry = index[dir];
+
+    if (pointerp(entry))
+    {
+        foreach(string name, int *data: entry[ENTRY_FILES])
+        {
+            if (data[FILE_SIZE] == -2)
+            {
+                forget_dir(SUBPATH(dir, name));
+            }
+        }
+    }
+
+    m_delkey(index, dir);
+    m_delkey(totals, dir);
+    m_delkey(dirty, dir);
+}
+
+/*
+ * Function name: scan_dir
+ * Description  : Reads a directory from disk into the index. Directories
+ *                below it that are new are queued for the crawler, those
+ *                that are gone are removed from the index.
+ * Arguments    : string dir - the directory.
+ */
+static void
+scan_dir(string dir)
+{
+    mapping files = ([ ]);
+    mixed  *old = index[dir];
+    string  path;
+
+    m_delkey(dirty, dir);
+    invalidate(dir);
+
+    if ((dir != "/") && (file_size(dir) != -2))
+    {
+        forget_dir(dir);
+        return;
+    }
+
+    foreach(string name: get_dir(SUBPATH(dir, "")) - ({ ".", ".." }))
+    {
+        path = SUBPATH(dir, name);
+        files[name] = ({ file_size(path), file_time(path) });
+
+        if ((files[name][FILE_SIZE] == -2) && !pointerp(index[path]))
+        {
+            queue = ({ path }) + queue;
+        }
+    }
+
+    if (pointerp(old))
+    {
+        foreach(string name, int *data: old[ENTRY_FILES])
+        {
+            if ((data[FILE_SIZE] == -2) &&
+                (!pointerp(files[name]) || (files[name][FILE_SIZE] != -2)))
+            {
+                forget_dir(SUBPATH(dir, name));
+            }
+        }
+    }
+
+    index[dir] = ({ files, time() });
+    pass_dirs++;
+    pass_files += m_sizeof(files);
+}
+
+/*
+ * Function name: sort_checked
+ * Description  : Sorts directories on the time they were read, oldest first.
+ */
+static int
+sort_checked(string a, string b)
+{
+    return index[a][ENTRY_CHECKED] - index[b][ENTRY_CHECKED];
+}
+
+/*
+ * Function name: crawl
+ * Description  : One step of the crawler. First the directories that were
+ *                written to are read, then those in the queue. When the
+ *                queue is empty, a new pass is started with all directories
+ *                in the index, the ones read longest ago first.
+ */
+static void
+crawl()
+{
+    int cost = EVAL_COST;
+    string dir;
+
+    while (EVAL_COST - cost < CRAWL_EVAL)
+    {
+        if (m_sizeof(dirty))
+        {
+            scan_dir(m_indices(dirty)[0]);
+            continue;
+        }
+
+        if (!sizeof(queue))
+        {
+            last_time = time() - pass_started;
+            last_dirs = pass_dirs;
+            last_files = pass_files;
+            passes++;
+
+            pass_started = time();
+            pass_dirs = 0;
+            pass_files = 0;
+            queue = sort_array(m_indices(index), &sort_checked());
+            break;
+        }
+
+        dir = queue[0];
+        queue = queue[1..];
+        scan_dir(dir);
+    }
+}
+
+/*
+ * Function name: note_write
+ * Description  : Called by the master when it allows a write. The directory
+ *                of the file is read again when it is asked for.
+ * Arguments    : string file - the file written to.
+ */
+public void
+note_write(string file)
+{
+    string dir;
+
+    if (previous_object() != find_object(SECURITY))
+    {
+        return;
+    }
+
+    dir = parent_dir(file);
+    if (pointerp(index[dir]))
+    {
+        dirty[dir] = 1;
+        invalidate(dir);
+    }
+}
+
+/*
+ * Function name: query_dir
+ * Description  : Gives the files in a directory, with their sizes and times.
+ *                The size of a directory is -2.
+ * Arguments    : string dir - the directory.
+ * Returns      : mapping - ([ (string) name : ({ (int) size, (int) time }) ])
+ *                          or 0 if the directory is not in the index.
+ */
+public mapping
+query_dir(string dir)
+{
+    dir = clean_path(dir);
+    if (!pointerp(index[dir]) ||
+        !SECURITY->valid_read(dir, previous_object(), "get_dir"))
+    {
+        return 0;
+    }
+
+    if (dirty[dir])
+    {
+        scan_dir(dir);
+    }
+
+    return (pointerp(index[dir]) ? (index[dir][ENTRY_FILES] + ([ ])) : 0);
+}
+
+/*
+ * Function name: compute_usage
+ * Description  : Gives the number of bytes and files in a directory and all
+ *                directories below it, from the totals when they are known.
+ * Arguments    : string dir - the directory, as key in the index.
+ * Returns      : int * - ({ bytes, files }) or 0 if part of the tree is not
+ *                        in the index yet.
+ */
+static int *
+compute_usage(string dir)
+{
+    mixed *entry;
+    int   *sum;
+    int   *sub;
+
+    if (dirty[dir])
+    {
+        scan_dir(dir);
+    }
+
+    if (pointerp(totals[dir]))
+    {
+        return totals[dir] + ({ });
+    }
+
+    if (!pointerp(entry = index[dir]))
+    {
+        return 0;
+    }
+
+    sum = ({ 0, 0 });
+    foreach(string name, int *data: entry[ENTRY_FILES])
+    {
+        if (data[FILE_SIZE] != -2)
+        {
+            sum[0] += max(data[FILE_SIZE], 0);
+            sum[1]++;
+        }
+        else if (pointerp(sub = compute_usage(SUBPATH(dir, name))))
+        {
+            sum[0] += sub[0];
+            sum[1] += sub[1];
+        }
+        else
+        {
+            return 0;
+        }
+    }
+
+    totals[dir] = sum;
+    return sum + ({ });
+}
+
+/*
+ * Function name: query_usage
+ * Description  : Gives the number of bytes and files in a directory and all
+ *                directories below it.
+ * Arguments    : string dir - the directory.
+ * Returns      : int * - ({ bytes, files }) or 0 if part of the tree is not
+ *                        in the index yet or the caller may not read it.
+ */
+public int *
+query_usage(string dir)
+{
+    dir = clean_path(dir);
+    if (!SECURITY->valid_read(dir, previous_object(), "get_dir"))
+    {
+        return 0;
+    }
+
+    return compute_usage(dir);
+}
+
+/*
+ * Function name: query_status
+ * Description  : Gives the state of the index and the pace of the crawler,
+ *                with the usage of the domains the caller may read.
+ * Returns      : string - the report.
+ */
+public string
+query_status()
+{
+    int    oldest = time();
+    int   *usage;
+    string text;
+
+    foreach(string dir, mixed *entry: index)
+    {
+        oldest = min(oldest, entry[ENTRY_CHECKED]);
+    }
+
+    text = sprintf("Indexed %d directories, %d waiting to be read again.\n",
+        m_sizeof(index), m_sizeof(dirty)) +
+        sprintf("This pass: %d directories and %d files in %s, %d to go.\n",
+        pass_dirs, pass_files, CONVTIME(max(time() - pass_started, 1)),
+        sizeof(queue));
+    if (passes)
+    {
+        text += sprintf("Last pass: %d directories and %d files in %s.\n",
+            last_dirs, last_files, CONVTIME(max(last_time, 1)));
+    }
+    text += "The oldest directory was read " +
+        CONVTIME(max(time() - oldest, 1)) + " ago.\n";
+
+    if (!pointerp(index["/d"]))
+    {
+        return text;
+    }
+
+    text += sprintf("\n%-20s %10s %8s\n", "Domain", "kB", "Files");
+    foreach(string domain: sort_array(m_indices(index["/d"][ENTRY_FILES])))
+    {
+        if ((index["/d"][ENTRY_FILES][domain][FILE_SIZE] != -2) ||
+            !SECURITY->valid_read("/d/" + domain, previous_object(),
+            "get_dir"))
+        {
+            continue;
+        }
+
+        if (pointerp(usage = compute_usage("/d/" + domain)))
+        {
+            text += sprintf("%-20s %10d %8d\n", domain, usage[0] / 1024,
+                usage[1]);
+        }
+        else
+        {
+            text += sprintf("%-20s %10s %8s\n", domain, "-", "-");
+        }
+    }
+
+    return text;
+}
+
+/*
+ * Function name: query_prevent_shadow
+ * Description  : We do not want anyone shadowing this object.
+ * Returns      : int 1 - always.
+ */
+public nomask int
+query_prevent_shadow()
+{
+    return 1;
+}
@@ -34,14 +34,34 @@ inherit "/lib/cache.c";
 
 #include "/d/Genesis/sys/deposit.h"
 
+/*
+ * Changes to an account are appended to its journal. The journal is merged
+ * into the account file when it has COMPACT_LINES lines, or when it was not
+ * written to for COMPACT_DELAY seconds. Every line ends in JOURNAL_END, so
+ * that a line that was cut off in a crash can be recognised.
+ */
+#define JOURNAL_FILE(n) (DEPOSIT_FILE(n) + ".journal")
+#define JOURNAL_END     (";")
+#define COMPACT_LINES   (50)
+#define COMPACT_DELAY   (600.0)
+
 /*
  * Global variable.
  */
 static private string  current_user = 0;
 static private mapping current_account = 0;
+static private mapping saved_account = 0;
 static private mapping gem_deposits = ([ ]);
 static private mapping transfers = ([ ]);
 
+/*
+ * journal_lines - ([ (string) name : (int) lines in the journal ])
+ * journal_stats - ({ (int) lines written, (int) bytes written,
+ *                    (int) compactions, (int) total eval, (int) max eval })
+ */
+static private mapping journal_lines = ([ ]);
+static private int    *journal_stats = ({ 0, 0, 0, 0, 0 });
+
 /*
  * Each account is saved in a separate file. The account contains both coins
  * and gems. The coins are listed in the number of coins per type. The gem
@@ -72,11 +92,24 @@ static private mapping transfers = ([ ]);
  *               (string) gem filename : (int) number of gems ]) ])
  */
 
+/*
+ * The journal of an account holds one change per line. The values are the
+ * new values, so replaying a line twice does no harm. Each line ends in
+ * JOURNAL_END:
+ *
+ * coins <copper> <silver> <gold> <platinum> ;
+ * time <time> ;
+ * fee <fee> ;
+ * gem <bank name> <gem filename> <number> ;   (0 removes the gem)
+ */
+
 /*
  * Prototype.
  */
 static void remove_idle_accounts(int letter);
 static void consolidate_accounts();
+static void compact_journals();
+static void compact_account();
 
 /*
  * Function name: create
@@ -93,6 +126,7 @@ create()
     set_cache_size(25);
 
     set_alarm(10.0, 0.0, &remove_idle_accounts(0));
+    set_alarm(COMPACT_DELAY, COMPACT_DELAY, compact_journals);
     
     transfers = restore_map(GEM_TRANSFERS);
     if (!mappingp(transfers))
@@ -250,6 +284,95 @@ convert_old_account()
     m_delkey(current_account, DEPOSIT_OLD_TM);
 }
 
+/*
+ * Function name: replay_journal
+ * Description  : Applies the journal of the current account to the account
+ *                as read from its file. Lines that do not end in
+ *                JOURNAL_END or have the wrong number of words, like a
+ *                last line that was cut off in a crash, are skipped. The
+ *                account is then compacted at once, so that nothing is
+ *                appended to the broken line.
+ */
+static void
+replay_journal()
+{
+    string text = read_file(JOURNAL_FILE(current_user));
+    string *words;
+    mapping bank;
+    int lines;
+    int broken;
+
+    if (!strlen(text))
+    {
+        journal_lines[current_user] = 0;
+        return;
+    }
+
+    foreach(string line: explode(text, "\n"))
+    {
+        words = explode(line, " ");
+        lines++;
+        if ((sizeof(words) < 3) ||
+            (words[sizeof(words) - 1] != JOURNAL_END))
+        {
+            broken = 1;
+            continue;
+        }
+        words = words[..(sizeof(words) - 2)];
+
+        switch(words[0])
+        {
+        case "coins":
+            if (sizeof(words) != (SIZEOF_MONEY_TYPES + 1))
+            {
+                broken = 1;
+                break;
+            }
+            current_account[DEPOSIT_COINS] = map(words[1..], atoi);
+            break;
+
+        case "time":
+            current_account[DEPOSIT_TIME] = atoi(words[1]);
+            break;
+
+        case "fee":
+            current_account[DEPOSIT_FEE] = atoi(words[1]);
+            break;
+
+        case "gem":
+            if (sizeof(words) != 4)
+            {
+                broken = 1;
+                break;
+            }
+            if (!mappingp(bank = current_account[words[1]]))
+            {
+                bank = current_account[words[1]] = ([ ]);
+            }
+            if (atoi(words[3]) > 0)
+            {
+                bank[words[2]] = atoi(words[3]);
+                break;
+            }
+            m_delkey(bank, words[2]);
+            if (!m_sizeof(bank))
+            {
+                m_delkey(current_account, words[1]);
+            }
+            break;
+
+        default:
+            broken = 1;
+        }
+    }
+
+    journal_lines[current_user] = lines;
+    if (broken)
+    {
+        compact_account();
+    }
+}
+
 /*
  * Function name: load_account
  * Description  : Internal routine to make sure the current account is active
@@ -281,7 +404,10 @@ load_account(string name, int nonew = 0)
         if (current_account[DEPOSIT_OLD_TM])
         {
             convert_old_account();
+            save_cache(current_account, DEPOSIT_FILE(current_user));
         }
+        replay_journal();
+        saved_account = secure_var(current_account);
         return 1;
     }
     /* Don't create a new account if we don't want it. */
@@ -295,18 +421,154 @@ load_account(string name, int nonew = 0)
         DEPOSIT_TIME : time(),
         DEPOSIT_FEE  : 0
         ]);
+    saved_account = 0;
     return 1;
 }
 
+/*
+ * Function name: compact_account
+ * Description  : Writes the current account to its file and removes the
+ *                journal.
+ */
+static void
+compact_account()
+{
+    int cost = EVAL_COST;
+
+    save_cache(current_account, DEPOSIT_FILE(current_user));
+    rm(JOURNAL_FILE(current_user));
+    m_delkey(journal_lines, current_user);
+    saved_account = secure_var(current_account);
+
+    cost = EVAL_COST - cost;
+    journal_stats[2]++;
+    journal_stats[3] += cost;
+    journal_stats[4] = max(journal_stats[4], cost);
+}
+
 /*
  * Function name: save_account
  * Description  : Internal routine to make sure the current account is stored
- *                safely to disk after processing.
+ *                safely to disk after processing. Only the changes since the
+ *                last save are appended to the journal of the account, and
+ *                only those are copied to the saved account.
  */
 static void
 save_account()
 {
-    save_cache(current_account, DEPOSIT_FILE(current_user));
+    string *lines = ({ });
+    string text;
+    mapping old;
+    mapping now;
+    mapping saved = ([ ]);
+
+    /* A new account gets its file at once. */
+    if (!mappingp(saved_account))
+    {
+        compact_account();
+        return;
+    }
+
+    text = implode(map(current_account[DEPOSIT_COINS], &operator(+)("")), " ");
+    if (text != implode(map(saved_account[DEPOSIT_COINS], &operator(+)("")), " "))
+    {
+        lines += ({ "coins " + text });
+        saved[DEPOSIT_COINS] = current_account[DEPOSIT_COINS] + ({ });
+    }
+    if (current_account[DEPOSIT_TIME] != saved_account[DEPOSIT_TIME])
+    {
+        lines += ({ "time " + current_account[DEPOSIT_TIME] });
+        saved[DEPOSIT_TIME] = current_account[DEPOSIT_TIME];
+    }
+    if (current_account[DEPOSIT_FEE] != saved_account[DEPOSIT_FEE])
+    {
+        lines += ({ "fee " + current_account[DEPOSIT_FEE] });
+        saved[DEPOSIT_FEE] = current_account[DEPOSIT_FEE];
+    }
+
+    foreach(string bank: filter(m_indices(current_account) |
+        m_indices(saved_account), &wildmatch(DEPOSIT_GEMS + "*", )))
+    {
+        now = (mappingp(current_account[bank]) ? current_account[bank] : ([ ]));
+        old = (mappingp(saved_account[bank]) ? saved_account[bank] : ([ ]));
+        foreach(string gem: m_indices(now) | m_indices(old))
+        {
+            if (now[gem] != old[gem])
+            {
+                lines += ({ "gem " + bank + " " + gem + " " + now[gem] });
+                saved[bank] = now + ([ ]);
+            }
+        }
+    }
+
+    if (!sizeof(lines))
+    {
+        return;
+    }
+
+    if (journal_lines[current_user] + sizeof(lines) > COMPACT_LINES)
+    {
+        compact_account();
+        return;
+    }
+
+    text = implode(lines, " " + JOURNAL_END + "\n") + " " + JOURNAL_END + "\n";
+    write_file(JOURNAL_FILE(current_user), text);
+    journal_lines[current_user] += sizeof(lines);
+    journal_stats[0] += sizeof(lines);
+    journal_stats[1] += strlen(text);
+
+    /* Only copy what changed. A gem bank that was emptied is removed. */
+    foreach(string key, mixed value: saved)
+    {
+        if (mappingp(value) && !m_sizeof(value))
+        {
+            m_delkey(saved_account, key);
+            continue;
+        }
+        saved_account[key] = value;
+    }
+}
+
+/*
+ * Function name: compact_journals
+ * Description  : Called every COMPACT_DELAY seconds to merge the journals
+ *                that were written to into the account files.
+ */
+static void
+compact_journals()
+{
+    foreach(string name: m_indices(journal_lines))
+    {
+        if (journal_lines[name] && load_account(name, 1))
+        {
+            compact_account();
+        }
+    }
+}
+
+/*
+ * Function name: query_journal_stats
+ * Description  : Gives the statistics of the account journals.
+ * Returns      : string - the statistics.
+ */
+public string
+query_journal_stats()
+{
+    int lines;
+
+    foreach(string name, int count: journal_lines)
+    {
+        lines += count;
+    }
+
+    return sprintf("Journals: %d lines in %d accounts waiting to be " +
+        "compacted.\nWritten: %d lines, %d bytes.\nCompactions: %d, " +
+        "average eval %d, maximum eval %d.\n", lines,
+        sizeof(filter(m_values(journal_lines), &operator(<)(0, ))),
+        journal_stats[0], journal_stats[1], journal_stats[2],
+        (journal_stats[2] ? (journal_stats[3] / journal_stats[2]) : 0),
+        journal_stats[4]);
 }
 
 /*
@@ -926,7 +1188,11 @@ rename_account(string oldname, string newname)
 	return 0;
     }
 
-    /* Remove from the cache before renaming the file. */
+    /* Merge the journal, then remove from the cache before renaming. */
+    if (load_account(oldname, 1))
+    {
+        compact_account();
+    }
     remove_from_cache(DEPOSIT_FILE(oldname));
     current_user = 0;
     rename(DEPOSIT_FILE(oldname) + ".o", DEPOSIT_FILE(newname) + ".o");
@@ -951,6 +1217,8 @@ remove_account(string name)
 
     log_transaction(TRANSACTION_OTHER, "Account removed.", name);
     rm_cache(DEPOSIT_FILE(name));
+    rm(JOURNAL_FILE(name));
+    m_delkey(journal_lines, name);
     current_user = 0;
     return 1;
 }
@@ -1011,9 +1279,14 @@ account(string str)
 
     if (!strlen(str))
     {
-        notify_fail("Syntax: Account [-g] <name>\n");
+        notify_fail("Syntax: Account [-g] <name> / Account -j\n");
         return 0;
     }
+    if (str == "-j")
+    {
+        write(query_journal_stats());
+        return 1;
+    }
     show_gems = sscanf(name = str, "-g %s", name);
 
     if (!query_has_account(name))
@@ -1070,6 +1343,7 @@ account(string str)
 public int
 remove_object()
 {
+    compact_journals();
     destruct();
     return 1;
 }
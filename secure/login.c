@@ -72,6 +72,9 @@ static void waitfun(string str);
 static void unbuffer_gmcp(object player);
 static void confirm_use_name(string str);
 static void who();
+static void restore_player(string str);
+static void verify_password(string pwd, int second_attempt);
+static void materialize_player();
 
 /*
  * Function name: clean_up
@@ -296,6 +299,25 @@ swap_to_player(object ob)
     destruct();
 }
 
+/*
+ * Function name: pipeline_failed
+ * Description  : Called by LOGIN_PIPELINE when a stage of the login ended in
+ *                an error. The login cannot continue, so we tell the player
+ *                and destruct.
+ */
+public void
+pipeline_failed()
+{
+    if (previous_object() != find_object(LOGIN_PIPELINE))
+    {
+        return;
+    }
+
+    write_socket("\nSomething went wrong while logging you in. Please " +
+        "try again later.\n");
+    destruct();
+}
+
 /*
  * Function name: validate_playerfile
  * Description  : The next step in the startup process. Almost there, now we
@@ -304,9 +326,24 @@ swap_to_player(object ob)
  */
 static void
 validate_playerfile()
+{
+    /* Creating the body is rate limited during reconnect storms. */
+    LOGIN_PIPELINE->request_stage(LOGIN_STAGE_MATERIALIZE, materialize_player);
+}
+
+/*
+ * Function name: materialize_player
+ * Description  : Clones the body of the player, restores it and enters the
+ *                game, loading the auto-loading and recoverable objects.
+ *                Called through LOGIN_PIPELINE.
+ */
+static void
+materialize_player()
 {
     object ob;
 
+    set_this_player(this_object());
+
     /* Now we can enter the game, find the player file */
     if (player_file)
     {
@@ -811,7 +848,6 @@ get_name(string str)
 {
     object g_info;
     object a_player;
-    int index;
     int runlevel;
     int delay;
 
@@ -940,6 +976,23 @@ get_name(string str)
         return;
     }
 
+    /* Reading the player file is rate limited during reconnect storms. */
+    LOGIN_PIPELINE->request_stage(LOGIN_STAGE_RESTORE, &restore_player(str));
+}
+
+/*
+ * Function name: restore_player
+ * Description  : Reads the player file of the player who wants to log in
+ *                and asks for the password. Called through LOGIN_PIPELINE.
+ * Arguments    : string str - the name of the player.
+ */
+static void
+restore_player(string str)
+{
+    int index;
+
+    set_this_player(this_object());
+
     /* No such player. Either typo, or player intends to be new ... */
     if (!restore_object(PLAYER_FILE(str)))
     {
@@ -1203,12 +1256,6 @@ check_double_login()
 static varargs void
 check_password(string pwd, int second_attempt = 0)
 {
-    object *players;
-    int     size;
-    int     index;
-    object  player;
-    string *names;
-
     log("check_password", "XXXXX");
 
     write_socket("\n");
@@ -1233,6 +1280,28 @@ check_password(string pwd, int second_attempt = 0)
         return;
     }
 
+    /* Checking the password is rate limited during reconnect storms. */
+    LOGIN_PIPELINE->request_stage(LOGIN_STAGE_PASSWORD,
+        &verify_password(pwd, second_attempt));
+}
+
+/*
+ * Function name: verify_password
+ * Description  : Checks the password and continues the login if it is
+ *                correct. Called through LOGIN_PIPELINE.
+ * Arguments    : string pwd - the intended password.
+ *                int second_attempt - if true, 2nd attempt at a password.
+ */
+static void
+verify_password(string pwd, int second_attempt)
+{
+    object *players;
+    int     size;
+    object  player;
+    string *names;
+
+    set_this_player(this_object());
+
     /* Password doesn't match */
     if (crypt(pwd, password, 0) != password)
     {
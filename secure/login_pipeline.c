@@ -0,0 +1,349 @@
+/*
+ * /secure/login_pipeline.c
+ *
+ * After a reboot hundreds of people reconnect within seconds. To keep the
+ * game from stalling, the expensive steps of the login are passed through
+ * this object. Each stage has a budget of logins it may process per second
+ * and the people who have to wait are served in the order they arrived.
+ * The stages are defined in <const.h>:
+ *
+ *   LOGIN_STAGE_RESTORE     - reading the player file in the login object;
+ *   LOGIN_STAGE_PASSWORD    - checking the password;
+ *   LOGIN_STAGE_MATERIALIZE - cloning the body, restoring it and loading
+ *                             the auto-loading and recoverable objects.
+ *
+ * For each stage a histogram of the latency (the time between the request
+ * and the moment the stage was done) is kept.
+ */
+
+#pragma no_clone
+#pragma no_inherit
+#pragma save_binary
+#pragma strict_types
+
+#include <const.h>
+#include <files.h>
+#include <log.h>
+#include <macros.h>
+#include <std.h>
+
+/*
+ * The default number of logins each stage may process per second.
+ */
+#define DEFAULT_BUDGET ([ LOGIN_STAGE_RESTORE : 20, \
+                          LOGIN_STAGE_PASSWORD : 10, \
+                          LOGIN_STAGE_MATERIALIZE : 5 ])
+
+/*
+ * The upper limits of the latency buckets, in seconds. The last bucket
+ * holds everything above.
+ */
+#define LATENCY_BUCKETS ({ 0.1, 0.5, 1.0, 2.0, 5.0, 10.0, 30.0, 60.0 })
+
+#define PROGRESS_TIME  (5)   /* Seconds between progress messages. */
+
+#define ENTRY_CALLBACK (0)
+#define ENTRY_START    (1)
+
+/*
+ * Global variables. They are not saved.
+ *
+ * budget    - ([ (int) stage : (int) logins per second ])
+ * used      - ([ (int) stage : (int) logins started this second ])
+ * waiting   - ([ (int) stage : ({ ({ (function) callback, (float) start }) }) ])
+ * histogram - ([ (int) stage : (int *) count per latency bucket ])
+ * max_cost  - ([ (int) stage : (int) the highest evaluation cost ])
+ * second    - the second the used budgets apply to.
+ */
+private static mapping budget    = DEFAULT_BUDGET;
+private static mapping used      = ([ ]);
+private static mapping waiting   = ([ ]);
+private static mapping histogram = ([ ]);
+private static mapping max_cost  = ([ ]);
+private static int     second;
+private static int     progress_time;
+private static int     drain_alarm;
+
+/*
+ * Prototype.
+ */
+static void drain();
+
+/*
+ * Function name: create
+ * Description  : Constructor.
+ */
+public void
+create()
+{
+    setuid();
+    seteuid(getuid());
+
+    foreach(int stage: LOGIN_STAGES)
+    {
+        used[stage] = 0;
+        waiting[stage] = ({ });
+        histogram[stage] = allocate(sizeof(LATENCY_BUCKETS) + 1);
+        max_cost[stage] = 0;
+    }
+}
+
+/*
+ * Function name: budget_left
+ * Description  : Finds out whether a stage may start another login in the
+ *                current second.
+ * Arguments    : int stage - the stage.
+ * Returns      : int 1/0 - true if there is budget left.
+ */
+static int
+budget_left(int stage)
+{
+    if (second != time())
+    {
+        second = time();
+        foreach(int index: LOGIN_STAGES)
+        {
+            used[index] = 0;
+        }
+    }
+
+    return (used[stage] < budget[stage]);
+}
+
+/*
+ * Function name: record_latency
+ * Description  : Adds the latency of a stage to its histogram.
+ * Arguments    : int stage - the stage.
+ *                float latency - the time in seconds.
+ */
+static void
+record_latency(int stage, float latency)
+{
+    int index = -1;
+    int size = sizeof(LATENCY_BUCKETS);
+
+    while((++index < size) && (latency > LATENCY_BUCKETS[index]))
+    {
+    }
+
+    histogram[stage][index]++;
+}
+
+/*
+ * Function name: run_stage
+ * Description  : Runs a stage for a login and records its latency. When the
+ *                stage ends in an error, the login cannot continue. The
+ *                error is logged and the login object is told to stop.
+ * Arguments    : int stage - the stage.
+ *                mixed *entry - the request, ({ callback, start }).
+ */
+static void
+run_stage(int stage, mixed *entry)
+{
+    object login = function_object(entry[ENTRY_CALLBACK]);
+    string error;
+    int cost;
+
+    /* The login went away while waiting. */
+    if (!objectp(login))
+    {
+        return;
+    }
+
+    cost = EVAL_COST;
+    error = catch(entry[ENTRY_CALLBACK]());
+    cost = EVAL_COST - cost;
+
+    max_cost[stage] = max(max_cost[stage], cost);
+    record_latency(stage, gettimeofday() - entry[ENTRY_START]);
+
+    if (stringp(error))
+    {
+#ifdef LOG_LOGIN_ERROR
+        SECURITY->log_syslog(LOG_LOGIN_ERROR, sprintf("%s stage %d %s: %s",
+            ctime(time()), stage,
+            (objectp(login) ? query_ip_number(login) : "-"), error));
+#endif
+        if (objectp(login))
+        {
+            login->pipeline_failed();
+        }
+    }
+}
+
+/*
+ * Function name: tell_waiting
+ * Description  : Tells the people who are waiting in a stage their position.
+ * Arguments    : int stage - the stage.
+ */
+static void
+tell_waiting(int stage)
+{
+    int position;
+    object login;
+
+    foreach(mixed *entry: waiting[stage])
+    {
+        if (objectp(login = function_object(entry[ENTRY_CALLBACK])))
+        {
+            tell_object(login, "The game is busy with people logging in. " +
+                "Please wait, you have position " + (++position) + ".\n");
+        }
+    }
+}
+
+/*
+ * Function name: request_stage
+ * Description  : Called by the login object to pass a stage of the login.
+ *                If the stage has budget left and nobody is waiting, the
+ *                callback is called at once. Otherwise it is called when it
+ *                is the turn of this login.
+ * Arguments    : int stage - the stage, LOGIN_STAGE_*.
+ *                function callback - the function to call.
+ */
+public void
+request_stage(int stage, function callback)
+{
+    mixed *entry;
+
+    if (!CALL_BY(LOGIN_OBJECT) ||
+        (member_array(stage, LOGIN_STAGES) == -1))
+    {
+        return;
+    }
+
+    entry = ({ callback, gettimeofday() });
+    if (!sizeof(waiting[stage]) && budget_left(stage))
+    {
+        used[stage]++;
+        run_stage(stage, entry);
+        return;
+    }
+
+    waiting[stage] += ({ entry });
+    tell_object(previous_object(), "The game is busy with people logging " +
+        "in. Please wait, you have position " + sizeof(waiting[stage]) +
+        ".\n");
+
+    if (!drain_alarm)
+    {
+        drain_alarm = set_alarm(1.0, 1.0, drain);
+    }
+}
+
+/*
+ * Function name: drain
+ * Description  : Called every second while people are waiting. Each stage
+ *                starts as many logins as its budget allows, in the order
+ *                in which they arrived. Every login is started in its own
+ *                alarm so they do not share an evaluation.
+ */
+static void
+drain()
+{
+    int busy;
+    int progress = (time() >= progress_time + PROGRESS_TIME);
+    mixed *entry;
+
+    foreach(int stage: LOGIN_STAGES)
+    {
+        while(sizeof(waiting[stage]) && budget_left(stage))
+        {
+            entry = waiting[stage][0];
+            waiting[stage] = waiting[stage][1..];
+
+            if (objectp(function_object(entry[ENTRY_CALLBACK])))
+            {
+                used[stage]++;
+                set_alarm(0.0, 0.0, &run_stage(stage, entry));
+            }
+        }
+
+        if (sizeof(waiting[stage]))
+        {
+            busy = 1;
+            if (progress)
+            {
+                tell_waiting(stage);
+            }
+        }
+    }
+
+    if (progress)
+    {
+        progress_time = time();
+    }
+
+    if (!busy)
+    {
+        remove_alarm(drain_alarm);
+        drain_alarm = 0;
+    }
+}
+
+/*
+ * Function name: set_budget
+ * Description  : Changes the number of logins a stage may start per second.
+ *                Only members of the administration may do this.
+ * Arguments    : int stage - the stage.
+ *                int count - the number of logins per second.
+ * Returns      : int 1/0 - success/failure.
+ */
+public int
+set_budget(int stage, int count)
+{
+    if ((SECURITY->query_wiz_rank(this_interactive()->query_real_name()) <
+        WIZ_ARCH) ||
+        (member_array(stage, LOGIN_STAGES) == -1) ||
+        (count < 1))
+    {
+        return 0;
+    }
+
+    budget[stage] = count;
+    return 1;
+}
+
+/*
+ * Function name: query_stats
+ * Description  : Gives the budgets, the number of people waiting and the
+ *                latency histograms of all stages.
+ * Returns      : string - the statistics.
+ */
+public string
+query_stats()
+{
+    string text;
+
+    text = sprintf("%-12s %6s %4s %8s", "Login stage", "Budget", "Wait",
+        "Max eval");
+    foreach(float limit: LATENCY_BUCKETS)
+    {
+        text += sprintf(" %5s", sprintf("<%.1f", limit));
+    }
+    text += "  more\n";
+
+    foreach(int stage: LOGIN_STAGES)
+    {
+        text += sprintf("%-12s %6d %4d %8d", LOGIN_STAGE_NAMES[stage],
+            budget[stage], sizeof(waiting[stage]), max_cost[stage]);
+        foreach(int count: histogram[stage])
+        {
+            text += sprintf(" %5d", count);
+        }
+        text += "\n";
+    }
+
+    return text;
+}
+
+/*
+ * Function name: query_prevent_shadow
+ * Description  : We do not want anyone shadowing this object.
+ * Returns      : int 1 - always.
+ */
+public nomask int
+query_prevent_shadow()
+{
+    return 1;
+}
@@ -81,6 +81,14 @@ private static int     uptime_limit;
 private static string  mudlib_version;
 private static int     game_start_time;
 
+/*
+ * inherit_users - ([ (string) program : ([ (string) user : (int) depth ]) ])
+ *                 For every inherited program the loaded programs that
+ *                 inherit it, with the number of programs the user inherits.
+ *                 Programs loaded before the master are not in it.
+ */
+private static mapping inherit_users = ([ ]);
+
 /*
  * Function name: create
  * Description  : This is the first function called in this object.
@@ -176,6 +184,11 @@ reset_master()
     /* Gather information for the graph command. */
     probe_for_graph();
 
+#ifdef LOG_BOOKKEEP_ROLLUP
+    /* Save the experience given by the domains. */
+    flush_exp_rollup();
+#endif LOG_BOOKKEEP_ROLLUP
+
     /* Save the master. */
     save_master();
 }
@@ -478,7 +491,7 @@ valid_seteuid(object ob, string str)
 }
 
 /*
- * Function name: valid_write
+ * Function name: check_write
  * Description  : Checks whether a certain user has the right to write a
  *                particular file.
  * Arguments    : string path  - the path name of the file to be write.
@@ -486,8 +499,8 @@ valid_seteuid(object ob, string str)
  *                string func  - the calling function.
  * Returns      : int 1/0 - allowed/disallowed.
  */
-int
-valid_write(string file, mixed writer, string func)
+static int
+check_write(string file, mixed writer, string func)
 {
     string *dirs, *wpath;
     string dname;
@@ -672,6 +685,38 @@ valid_write(string file, mixed writer, string func)
     return 0;
 }
 
+/*
+ * Function name: valid_write
+ * Description  : Checks whether a certain user has the right to write a
+ *                particular file. When the write is allowed, the file index
+ *                and the document index are told that the directory of the
+ *                file changes.
+ * Arguments    : string path  - the path name of the file to be write.
+ *                mixed writer - the name or object of the writer.
+ *                string func  - the calling function.
+ * Returns      : int 1/0 - allowed/disallowed.
+ */
+int
+valid_write(string file, mixed writer, string func)
+{
+    object index;
+
+    if (!check_write(file, writer, func))
+    {
+        return 0;
+    }
+
+    if (objectp(index = find_object(FILE_INDEX)))
+    {
+        catch(index->note_write(file));
+    }
+    if (objectp(index = find_object(DOC_INDEX)))
+    {
+        catch(index->note_write(file));
+    }
+    return 1;
+}
+
 /*
  * Function name: valid_read
  * Description  : Checks if a certain user has the right to read a file.
@@ -1715,6 +1760,11 @@ final_shutdown()
     /* Process the graph data even if this isn't the top of the hour. */
     graph_process_data();
 
+#ifdef LOG_BOOKKEEP_ROLLUP
+    /* Save the experience given by the domains. */
+    flush_exp_rollup();
+#endif LOG_BOOKKEEP_ROLLUP
+
     /* It's a proper shutdown, so we are not started. */
     game_started = 0;
     /* Save the master. */
@@ -1929,6 +1979,82 @@ simul_efun_reload()
     set_auth(find_object(SIMUL_EFUN), "root:root");
 }
 
+/*
+ * Function name: index_inherits
+ * Description  : Adds a newly loaded program to the reverse inherit index.
+ * Arguments    : object ob - the loaded object.
+ */
+static void
+index_inherits(object ob)
+{
+    string file = MASTER_OB(ob) + ".c";
+    string *parents = do_debug("inherit_list", ob) - ({ file });
+    int depth = sizeof(parents);
+
+    foreach(string parent: parents)
+    {
+        if (!mappingp(inherit_users[parent]))
+        {
+            inherit_users[parent] = ([ ]);
+        }
+
+        inherit_users[parent][file] = depth;
+    }
+}
+
+/*
+ * Function name: sort_inherit_users
+ * Description  : Sorts programs on the number of programs they inherit. A
+ *                program always inherits more than the programs it inherits,
+ *                so parents come before their children.
+ */
+static int
+sort_inherit_users(mapping users, string a, string b)
+{
+    return users[a] - users[b];
+}
+
+/*
+ * Function name: query_inherit_users
+ * Description  : Finds the loaded programs that inherit a program, directly
+ *                or through other programs. They are sorted parents before
+ *                children, so they can be reloaded in this order. Programs
+ *                that are no longer loaded are removed from the index.
+ * Arguments    : string file - the program, with or without .c.
+ * Returns      : string * - the programs, with .c.
+ */
+public string *
+query_inherit_users(string file)
+{
+    mapping users;
+
+    if (!wildmatch("*.c", file))
+    {
+        file += ".c";
+    }
+
+    if (!mappingp(users = inherit_users[file]))
+    {
+        return ({ });
+    }
+
+    foreach(string user: m_indices(users))
+    {
+        if (!objectp(find_object(user)))
+        {
+            m_delkey(users, user);
+        }
+    }
+
+    if (!m_sizeof(users))
+    {
+        m_delkey(inherit_users, file);
+        return ({ });
+    }
+
+    return sort_array(m_indices(users), &sort_inherit_users(users));
+}
+
 /*
  * Function name: loaded_object
  * Description  : This function is called when an object is loaded into
@@ -1961,6 +2087,8 @@ loaded_object(object lob, object ob)
         return;
     }
 
+    index_inherits(ob);
+
     if ((creator == BACKBONE_UID) ||
         (creator == auth[0]))
     {
@@ -2105,14 +2233,14 @@ query_command_substitute(string cmd)
 }
 
 /*
- * Function name: query_memory_percentage
- * Description  : This function will return the percentage of memory usage
- *                of the game so far. When the counter reaches 100, it is
- *                time to reboot.
- * Returns      : int - the relative memory usage.
+ * Function name: query_memory_used
+ * Description  : This function will return the current size of the heap of
+ *                the game, as reported by debug("malloc"). Unlike the
+ *                maximum resident size it also shrinks when memory is freed.
+ * Returns      : int - the size of the heap in bytes.
  */
 nomask public int
-query_memory_percentage()
+query_memory_used()
 {
     string data = SECURITY->do_debug("malloc");
     string *rows = explode(data, "\n");
@@ -2125,7 +2253,20 @@ query_memory_percentage()
         sscanf(rows[-1], "Total heap size: %d", used);
     }
 
-	return (used / (memory_limit / 100));
+    return used;
+}
+
+/*
+ * Function name: query_memory_percentage
+ * Description  : This function will return the percentage of memory usage
+ *                of the game so far. When the counter reaches 100, it is
+ *                time to reboot.
+ * Returns      : int - the relative memory usage.
+ */
+nomask public int
+query_memory_percentage()
+{
+	return (query_memory_used() / (memory_limit / 100));
 }
 
 /*
@@ -20,6 +20,13 @@ private mapping m_applications; /* The applications mapping */
 private mapping m_global_read;  /* The global read mapping */
 private mapping m_teams;        /* The arch team mapping */
 
+/*
+ * The experience given since the last flush, not stored in KEEPERSAVE.
+ * ([ (int) day : ([ (string) domain : ([ (string) wizard :
+ *     ([ (string) type : ({ (int) exp, (int) count }) ]) ]) ]) ])
+ */
+static mapping m_exp_pending = ([ ]);
+
 /**************************************************************************
  *
  * The 'm_domains' mapping holds the domain name as index and an array with
@@ -111,6 +118,14 @@ private mapping m_teams;        /* The arch team mapping */
 #define FOB_WIZ_STUDENTS  7
 
 
+/* The arrays in the experience rollups. */
+#define FOB_XP_EXP        0
+#define FOB_XP_COUNT      1
+
+#define FOB_XP_DAY        (time() / 86400)
+#define FOB_XP_FILE(day)  ("/syslog/log/" + LOG_BOOKKEEP_ROLLUP + "." + \
+                           TIME2FORMAT((day) * 86400, "yyyymmdd"))
+
 /* Arrays in the teams mapping */
 #define FOB_TEAM_LEADER   0
 #define FOB_TEAM_MEMBERS  1
@@ -1586,12 +1601,47 @@ list_applications(string str)
  *
  */
 
+#ifdef LOG_BOOKKEEP_ROLLUP
+/*
+ * Function name: add_exp_rollup
+ * Description  : Adds experience to the totals in a rollup mapping.
+ * Arguments    : mapping rollup - the mapping, see m_exp_pending.
+ *                int day - the day number.
+ *                string dname - the domain.
+ *                string wname - the wizard, or domain, of the giver.
+ *                string type - the type of experience.
+ *                int *value - ({ exp, count }) to add.
+ */
+static void
+add_exp_rollup(mapping rollup, int day, string dname, string wname,
+    string type, int *value)
+{
+    if (!mappingp(rollup[day]))
+        rollup[day] = ([ ]);
+    if (!mappingp(rollup[day][dname]))
+        rollup[day][dname] = ([ ]);
+    if (!mappingp(rollup[day][dname][wname]))
+        rollup[day][dname][wname] = ([ ]);
+    if (!pointerp(rollup[day][dname][wname][type]))
+    {
+        rollup[day][dname][wname][type] = value + ({ });
+        return;
+    }
+
+    rollup[day][dname][wname][type][FOB_XP_EXP] += value[FOB_XP_EXP];
+    rollup[day][dname][wname][type][FOB_XP_COUNT] += value[FOB_XP_COUNT];
+}
+
+#endif LOG_BOOKKEEP_ROLLUP
+
 /*
  * Function name: bookkeep_exp
  * Description  : Note the xp domains give to the mortals and what kind.
  *                This is not saved each time to KEEPERSAVE, we trust it
  *                to be saved at one time or other. Exact bookkeeping is not
- *                absolutely crucial and it would take a lot of time.
+ *                absolutely crucial and it would take a lot of time. The
+ *                daily totals are kept in memory and written on a reset of
+ *                the master, see flush_exp_rollup().
  * Arguments    : string type - the type of experience being added, can
  *                    be "quest", "combat" and general".
  *                int exp - the amount of experience added.
@@ -1602,7 +1652,7 @@ bookkeep_exp(string type, int exp)
     int    cobj = 0;
     int    should_log = 0;
     string dname = "";
-    string log;
+    string wname;
     object pobj = previous_object();
     object giver = previous_object(-1);
 
@@ -1665,7 +1715,7 @@ bookkeep_exp(string type, int exp)
 #endif LOG_BOOKKEEP_ERR
 
     /* Get the euid of the experience giving object. */
-    dname = geteuid(giver);
+    dname = wname = geteuid(giver);
     if (sizeof(m_wizards[dname]))
         dname = m_wizards[dname][FOB_WIZ_DOM];
 
@@ -1732,19 +1782,158 @@ bookkeep_exp(string type, int exp)
     }
 #endif LOG_BOOKKEEP
 
-#ifdef LOG_BOOKKEEP_ROTATE
-    /* Cycle the log with the same day number every month. */
-    log = "/syslog/log/" + LOG_BOOKKEEP_ROTATE + "." + TIME2FORMAT(time(), "dd");
-    if ((file_size(log) > 0) &&
-        ((file_time(log) + 86400) < time()))
+#ifdef LOG_BOOKKEEP_ROLLUP
+    /* Add it to the totals of today. They are saved by flush_exp_rollup(). */
+    add_exp_rollup(m_exp_pending, FOB_XP_DAY, dname, wname, type,
+        ({ exp, 1 }));
+#endif LOG_BOOKKEEP_ROLLUP
+}
+
+#ifdef LOG_BOOKKEEP_ROLLUP
+/*
+ * Function name: flush_exp_rollup
+ * Description  : Adds the experience given since the last flush to the
+ *                rollup file of the day and removes all rollups that are
+ *                too old, also those of days the game was down. Called from
+ *                reset_master() and at shutdown.
+ */
+static void
+flush_exp_rollup()
+{
+    mapping rollup;
+    string  file;
+    string  dir;
+    string  oldest;
+
+    if (!m_sizeof(m_exp_pending))
+        return;
+
+    set_auth(this_object(), "root:root");
+    dir = "/syslog/log/" +
+        implode(explode(LOG_BOOKKEEP_ROLLUP, "/")[..-2], "/");
+    if (file_size(dir) != -2)
+        mkdir(dir);
+
+    foreach(int day, mapping domains: m_exp_pending)
     {
-        rm(log);
+        file = FOB_XP_FILE(day);
+        rollup = ([ day : restore_map(file) ]);
+        if (!mappingp(rollup[day]))
+            rollup[day] = ([ ]);
+
+        foreach(string dname, mapping wizards: domains)
+        {
+            foreach(string wname, mapping types: wizards)
+            {
+                foreach(string type, int *value: types)
+                {
+                    add_exp_rollup(rollup, day, dname, wname, type, value);
+                }
+            }
+        }
+
+        save_map(rollup[day], file);
     }
 
-    write_file(log, sprintf("%s %-12s %-7s(%8d) %-1s\n",
-            ctime(time()), capitalize(pobj->query_real_name()),
-            type, exp, file_name(giver)));
-#endif LOG_BOOKKEEP_ROTATE
+    /* The dates in the names sort like the names themselves. */
+    oldest = FOB_XP_FILE(FOB_XP_DAY - LOG_BOOKKEEP_KEEP + 1)[strlen(dir) + 1..];
+    file = explode(oldest, ".")[0] + ".*";
+    foreach(string name: get_dir(dir + "/"))
+    {
+        if (wildmatch(file, name) && (name < oldest))
+            rm(dir + "/" + name);
+    }
+
+    m_exp_pending = ([ ]);
+}
+#endif LOG_BOOKKEEP_ROLLUP
+
+/*
+ * Function name: query_exp_given
+ * Description  : Gives the experience given by the domains in the last
+ *                days, from the rollups. For one domain, it is given per
+ *                wizard or domain that gave it.
+ * Arguments    : string dname - the domain, or 0 for all domains.
+ *                int days - the number of days, including today.
+ * Returns      : string - the report, or 0 if not allowed.
+ */
+public string
+query_exp_given(string dname, int days)
+{
+#ifdef LOG_BOOKKEEP_ROLLUP
+    mapping totals = ([ ]);
+    mapping rollup;
+    string  text;
+    string  key;
+    int     today = FOB_XP_DAY;
+    int     day;
+#endif LOG_BOOKKEEP_ROLLUP
+
+    /* May only be called from the 'normal' wizard soul. */
+    if (!CALL_BY(WIZ_CMD_NORMAL))
+        return 0;
+
+#ifdef LOG_BOOKKEEP_ROLLUP
+    days = max(1, min(days, LOG_BOOKKEEP_KEEP));
+    for (day = today - days + 1; day <= today; day++)
+    {
+        set_auth(this_object(), "root:root");
+        rollup = restore_map(FOB_XP_FILE(day));
+        rollup = ([ 0 : (mappingp(rollup) ? rollup : ([ ])) ]);
+        if (mappingp(m_exp_pending[day]))
+        {
+            foreach(string dom, mapping wizards: m_exp_pending[day])
+            {
+                foreach(string wname, mapping types: wizards)
+                {
+                    foreach(string type, int *value: types)
+                    {
+                        add_exp_rollup(rollup, 0, dom, wname, type, value);
+                    }
+                }
+            }
+        }
+
+        foreach(string dom, mapping wizards: rollup[0])
+        {
+            if (stringp(dname) && (dom != dname))
+                continue;
+
+            foreach(string wname, mapping types: wizards)
+            {
+                key = (stringp(dname) ? wname : dom);
+                foreach(string type, int *value: types)
+                {
+                    add_exp_rollup(totals, 0, key, "", type, value);
+                }
+            }
+        }
+    }
+
+    text = sprintf("Experience given %s in the last %d day%s.\n" +
+        "%-12s %12s %7s %12s %7s %12s %7s\n",
+        (stringp(dname) ? ("by " + dname) : "by the domains"), days,
+        ((days == 1) ? "" : "s"), (stringp(dname) ? "Giver" : "Domain"),
+        "Quest", "#", "Combat", "#", "General", "#");
+    if (!mappingp(totals[0]))
+        return text + "Nothing was given.\n";
+
+    foreach(string name: sort_array(m_indices(totals[0])))
+    {
+        text += sprintf("%-12s", capitalize(name));
+        foreach(string type: ({ "quest", "combat", "general" }))
+        {
+            text += (pointerp(totals[0][name][""][type]) ?
+                sprintf(" %12d %7d", totals[0][name][""][type][FOB_XP_EXP],
+                    totals[0][name][""][type][FOB_XP_COUNT]) :
+                sprintf(" %12s %7s", "-", "-"));
+        }
+        text += "\n";
+    }
+    return text;
+#else
+    return "The experience given by the domains is not added up.\n";
+#endif LOG_BOOKKEEP_ROLLUP
 }
 
 /*
@@ -2207,6 +2396,7 @@ do_change_rank(string wname, int rank, string cmder)
     {
         wizard->reset_userids();
         wizard->update_hooks();
+        PRESENCE_CENTRAL->update_presence(wizard);
     }
 }
 
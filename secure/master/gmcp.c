@@ -8,9 +8,92 @@
 #include "/sys/gmcp.h"
 #include "/sys/ss_types.h"
 
+/*
+ * The log lines are kept in a ring buffer and written on an alarm. When the
+ * buffer is full before it is written, the oldest lines are lost.
+ */
+#define GMCP_LOG_RING   (500)
+#define GMCP_LOG_FLUSH  (10.0)
+
+/*
+ * Every connection may send GMCP_RATE packages per second, with bursts of
+ * up to GMCP_BURST packages. Anything more is dropped. The time the driver
+ * gives only changes every heartbeat, so the tokens come back in steps.
+ */
+#define GMCP_RATE       (20.0)
+#define GMCP_BURST      (50.0)
+
+#define GSTAT_COUNT     (0)
+#define GSTAT_COST      (1)
+#define GSTAT_DROPPED   (2)
+
+/*
+ * Chunked file writes. The chunks are written to a temporary file on an
+ * alarm and the file is renamed when the last chunk is in. A transfer that
+ * is idle for GMCP_TRANSFER_IDLE seconds is removed. A wizard may have at
+ * most GMCP_TRANSFER_OPEN transfers open and GMCP_TRANSFER_QUEUED bytes
+ * waiting to be written, which is enough for one write in the old form
+ * with all text in one package.
+ */
+#define GMCP_WRITE_DELAY     (0.2)
+#define GMCP_TRANSFER_IDLE   (900)
+#define GMCP_TRANSFER_MAX    (4194304)
+#define GMCP_TRANSFER_OPEN   (4)
+#define GMCP_TRANSFER_QUEUED (GMCP_TRANSFER_MAX)
+
+#define ADLER_BASE      (65521)
+
+#define GXFER_NAME      (0)
+#define GXFER_PATH      (1)
+#define GXFER_TEMP      (2)
+#define GXFER_SIZE      (3)
+#define GXFER_CHECKSUM  (4)
+#define GXFER_RECEIVED  (5)
+#define GXFER_ADLER     (6)
+#define GXFER_QUEUE     (7)
+#define GXFER_TIME      (8)
+
+#define BUCKET_TOKENS   (0)
+#define BUCKET_TIME     (1)
+#define BUCKET_DROPPED  (2)
+#define BUCKET_NAME     (3)
+
 static int     gmcp_alarm;
 static mapping gmcp_tokens = ([ ]);
 
+/*
+ * gmcp_stats   - ([ (string) package : ({ (int) count, (int) cost,
+ *                                         (int) dropped }) ])
+ * gmcp_buckets - ([ (object) player : ({ (float) tokens, (float) time,
+ *                                        (int) dropped, (string) name }) ])
+ * gmcp_log     - the ring buffer of log lines, gmcp_log_head is where the
+ *                next line goes and gmcp_log_size the number not written.
+ */
+static mapping gmcp_stats = ([ ]);
+static mapping gmcp_buckets = ([ ]);
+static string *gmcp_log = allocate(GMCP_LOG_RING);
+static int     gmcp_log_head;
+static int     gmcp_log_size;
+static int     gmcp_log_lost;
+static int     gmcp_stats_time;
+
+/*
+ * gmcp_transfers - ([ (string) session : ({ (string) wizard, (string) path,
+ *                      (string) temp, (int) size, (int) checksum,
+ *                      (int) received, (int *) adler, (string *) queue,
+ *                      (int) time }) ])
+ */
+static mapping gmcp_transfers = ([ ]);
+static int     gmcp_write_alarm;
+static int     gmcp_sessions;
+
+/*
+ * Prototype.
+ */
+public void flush_gmcp_log();
+static void gmcp_transfer_status(string session, string status,
+    string error);
+
 /*
  * Function name: gmcp_refresh
  * Description  : This routine is called from the GMCP alarm in order to cause
@@ -31,6 +114,144 @@ init_gmcp()
 {
     /* The alarm needed to cause the GMCP indicators of players to go up. */
     gmcp_alarm = set_alarm(GMCP_INTERVAL, GMCP_INTERVAL, gmcp_refresh);
+
+    /* The alarm to write the GMCP log. */
+    set_alarm(GMCP_LOG_FLUSH, GMCP_LOG_FLUSH, flush_gmcp_log);
+    gmcp_stats_time = time();
+}
+
+/*
+ * Function name: gmcp_log_line
+ * Description  : Adds a line to the GMCP log. It is written on an alarm.
+ * Arguments    : string line - the line, without time stamp and newline.
+ */
+static void
+gmcp_log_line(string line)
+{
+    if (gmcp_log_size == GMCP_LOG_RING)
+    {
+        gmcp_log_lost++;
+    }
+    else
+    {
+        gmcp_log_size++;
+    }
+
+    gmcp_log[gmcp_log_head] = ctime(time()) + " " + line + "\n";
+    gmcp_log_head = (gmcp_log_head + 1) % GMCP_LOG_RING;
+}
+
+/*
+ * Function name: flush_gmcp_log
+ * Description  : Called from an alarm to write the GMCP log lines that are
+ *                waiting in one go. It also forgets the rate limits of the
+ *                connections that are gone and the file transfers that are
+ *                idle for too long.
+ */
+public void
+flush_gmcp_log()
+{
+    int start;
+
+    if (gmcp_log_size)
+    {
+        start = (gmcp_log_head - gmcp_log_size + GMCP_LOG_RING) % GMCP_LOG_RING;
+        if (start + gmcp_log_size <= GMCP_LOG_RING)
+        {
+            log_file(LOG_GMCP, implode(gmcp_log[start..(start +
+                gmcp_log_size - 1)], ""), LOG_SIZE_1M);
+        }
+        else
+        {
+            log_file(LOG_GMCP, implode(gmcp_log[start..] +
+                gmcp_log[..(gmcp_log_head - 1)], ""), LOG_SIZE_1M);
+        }
+
+        if (gmcp_log_lost)
+        {
+            log_file(LOG_GMCP, ctime(time()) + " " + gmcp_log_lost +
+                " lines lost, the log buffer was full.\n", LOG_SIZE_1M);
+            gmcp_log_lost = 0;
+        }
+        gmcp_log_size = 0;
+    }
+
+    foreach(object player: m_indices(gmcp_buckets))
+    {
+        if (!objectp(player))
+        {
+            m_delkey(gmcp_buckets, player);
+        }
+    }
+
+    foreach(string session: m_indices(gmcp_transfers))
+    {
+        if (!sizeof(gmcp_transfers[session][GXFER_QUEUE]) &&
+            (gmcp_transfers[session][GXFER_TIME] + GMCP_TRANSFER_IDLE <
+                time()))
+        {
+            gmcp_transfer_status(session, "error", "Transfer timed out.");
+        }
+    }
+}
+
+/*
+ * Function name: gmcp_allowed
+ * Description  : The token bucket of a connection. Each package takes a
+ *                token and tokens come back at GMCP_RATE per second.
+ * Arguments    : object player - the connection.
+ * Returns      : int 1/0 - true if the package may be processed.
+ */
+static int
+gmcp_allowed(object player)
+{
+    mixed *bucket = gmcp_buckets[player];
+    float  now = gettimeofday();
+
+    if (!pointerp(bucket))
+    {
+        bucket = gmcp_buckets[player] = ({ GMCP_BURST, now, 0,
+            player->query_real_name() });
+    }
+
+    bucket[BUCKET_TOKENS] += (now - bucket[BUCKET_TIME]) * GMCP_RATE;
+    if (bucket[BUCKET_TOKENS] > GMCP_BURST)
+    {
+        bucket[BUCKET_TOKENS] = GMCP_BURST;
+    }
+    bucket[BUCKET_TIME] = now;
+
+    if (bucket[BUCKET_TOKENS] < 1.0)
+    {
+        /* Only log the first package that is dropped in a burst. */
+        if (!bucket[BUCKET_DROPPED]++)
+        {
+            gmcp_log_line(capitalize(player->query_real_name() || "<none>") +
+                ": rate limited.");
+        }
+        return 0;
+    }
+
+    bucket[BUCKET_TOKENS] -= 1.0;
+    bucket[BUCKET_DROPPED] = 0;
+    return 1;
+}
+
+/*
+ * Function name: gmcp_stat
+ * Description  : Gives the statistics of a package, creating them if needed.
+ * Arguments    : string package - the package.
+ * Returns      : mixed * - the statistics, see GSTAT_*.
+ */
+static mixed *
+gmcp_stat(string package)
+{
+    if (!pointerp(gmcp_stats[package]))
+    {
+        gmcp_stats[package] = ({ 0, 0, 0 });
+    }
+
+    return gmcp_stats[package];
 }
 
 /*
@@ -166,18 +387,94 @@ gmcp_get_dir(object player, mixed data)
     player->catch_gmcp(GMCP_FILES_DIR_LIST, result);
 }
 
+/*
+ * Function name: gmcp_adler
+ * Description  : Computes the Adler-32 checksum of a text. The checksum can
+ *                be computed in parts by passing the state of the previous
+ *                part.
+ * Arguments    : string text - the text.
+ *                int *state - ({ a, b }) of the text before, or ({ 1, 0 }).
+ * Returns      : int * - ({ a, b }) the new state.
+ */
+static int *
+gmcp_adler(string text, int *state)
+{
+    int a = state[0];
+    int b = state[1];
+    int size = strlen(text);
+    int index = -1;
+
+    while(++index < size)
+    {
+        a = (a + text[index]) % ADLER_BASE;
+        b = (b + a) % ADLER_BASE;
+    }
+
+    return ({ a, b });
+}
+
+/*
+ * Function name: gmcp_adler_append
+ * Description  : Gives the Adler-32 state of two texts after each other
+ *                from the states of both, so that a chunk does not have to
+ *                be summed twice.
+ * Arguments    : int *state - ({ a, b }) of the first text.
+ *                int *part - ({ a, b }) of the second text on its own.
+ *                int size - the length of the second text.
+ * Returns      : int * - ({ a, b }) of both texts.
+ */
+static int *
+gmcp_adler_append(int *state, int *part, int size)
+{
+    int a = (state[0] + part[0] + ADLER_BASE - 1) % ADLER_BASE;
+    int b = (state[1] + part[1] + (size % ADLER_BASE) *
+        ((state[0] + ADLER_BASE - 1) % ADLER_BASE)) % ADLER_BASE;
+
+    return ({ a, b });
+}
+
+/*
+ * Function name: gmcp_checksum
+ * Description  : Gives the Adler-32 checksum of a text as a single number.
+ * Arguments    : string text - the text.
+ * Returns      : int - the checksum.
+ */
+static int
+gmcp_checksum(string text)
+{
+    int *state = gmcp_adler(text, ({ 1, 0 }));
+
+    return (state[1] << 16) | state[0];
+}
+
 /*
  * Function name: gmcp_read_file
- * Description  : Reads a file from the GMCP client.
+ * Description  : Reads a file from the GMCP client. A file is sent in chunks
+ *                of at most GMCP_CHUNK_SIZE bytes. The client asks for the
+ *                next chunk with the offset it got so far.
  * Arguments    : object player - the player reading the file.
- *                mixed data - the filename to read. May have ~ notation.
+ *                mixed data - the filename to read. May have ~ notation. Or
+ *                    a mapping with the path, offset and length.
  */
 static void
 gmcp_read_file(object player, mixed data)
 {
     string wname = player->query_real_name();
     string path;
+    string text;
+    int offset;
+    int length = GMCP_CHUNK_SIZE;
+    int size;
 
+    if (mappingp(data))
+    {
+        offset = max(0, intp(data[GMCP_OFFSET]) ? data[GMCP_OFFSET] : 0);
+        if (intp(data[GMCP_LENGTH]) && (data[GMCP_LENGTH] > 0))
+        {
+            length = min(data[GMCP_LENGTH], GMCP_CHUNK_SIZE);
+        }
+        data = data[GMCP_PATH];
+    }
     if (!stringp(data))
     {
 	return;
@@ -189,48 +486,85 @@ gmcp_read_file(object player, mixed data)
     /* Only allow wizards to proceed as we don't want to expose open dirs to
      * players. */
     if (!query_wiz_rank(wname) ||
-        !valid_read(path, player, "read"))
+        !valid_read(path, player, "read") ||
+        ((size = file_size(path)) < 0))
     {
 	return;
     }
-    player->catch_gmcp(GMCP_FILES_READ, ([ GMCP_PATH : path, GMCP_TEXT : read_file(path) ]) );
+    text = ((offset < size) ? read_bytes(path, offset, length) : 0);
+    text = (stringp(text) ? text : "");
+    player->catch_gmcp(GMCP_FILES_READ, ([ GMCP_PATH : path, GMCP_TEXT : text,
+        GMCP_OFFSET : offset, GMCP_LENGTH : strlen(text), GMCP_SIZE : size,
+        GMCP_TIME : file_time(path), GMCP_CHECKSUM : gmcp_checksum(text) ]) );
 }
 
 /*
- * Function name: gmcp_write_file
- * Description  : Writes a file from the GMCP client.
- * Arguments    : object player - the player reading the file.
- *                mixed data - the paramters.
+ * Function name: gmcp_transfer_status
+ * Description  : Tells the client how far a write is. When the write is done
+ *                or failed, the transfer is removed.
+ * Arguments    : string session - the transfer.
+ *                string status - "open", "done" or "error".
+ *                string error - the reason, when it failed.
  */
 static void
-gmcp_write_file(object player, mixed data)
+gmcp_transfer_status(string session, string status, string error)
 {
-    string wname = player->query_real_name();
-    string path;
-    int index = 1;
+    mixed *transfer = gmcp_transfers[session];
+    object player = find_player(transfer[GXFER_NAME]);
+    mapping result = ([ GMCP_SESSION : session,
+        GMCP_PATH : transfer[GXFER_PATH], GMCP_STATUS : status,
+        GMCP_OFFSET : transfer[GXFER_RECEIVED],
+        GMCP_SIZE : transfer[GXFER_SIZE] ]);
 
-    /* Access failure. */
-    if (!mappingp(data) ||
-        !strlen(data[GMCP_PATH]) ||
-	!strlen(data[GMCP_TEXT]))
+    if (status != "open")
     {
-	return;
+        m_delkey(gmcp_transfers, session);
+        if (status == "error")
+        {
+            set_auth(this_object(), "root:" + transfer[GXFER_NAME]);
+            rm(transfer[GXFER_TEMP]);
+            result[GMCP_ERROR] = error;
+        }
     }
-    set_auth(this_object(), "root:" + wname);
-    /* Ensure path is just a straight path. */
-    path = FTPATH((string)player->query_path(), data[GMCP_PATH]);
 
-    /* Only allow wizards to proceed, just for good measure. */
-    if (!query_wiz_rank(wname) ||
-        !valid_write(path, player, "write"))
+    if (objectp(player))
     {
-	return;
+        player->catch_gmcp(GMCP_FILES_WRITE_STATUS, result);
+    }
+}
+
+/*
+ * Function name: gmcp_commit_file
+ * Description  : Puts the temporary file of a finished write in place. The
+ *                old file is kept as a numbered backup.
+ * Arguments    : string session - the transfer.
+ */
+static void
+gmcp_commit_file(string session)
+{
+    mixed *transfer = gmcp_transfers[session];
+    string path = transfer[GXFER_PATH];
+    int index = 1;
+
+    if (file_size(transfer[GXFER_TEMP]) != transfer[GXFER_SIZE])
+    {
+        gmcp_transfer_status(session, "error", "Size mismatch.");
+        return;
+    }
+    /* An Adler-32 checksum is never 0, so 0 means none was sent. */
+    if (intp(transfer[GXFER_CHECKSUM]) && transfer[GXFER_CHECKSUM] &&
+        (transfer[GXFER_CHECKSUM] != ((transfer[GXFER_ADLER][1] << 16) |
+            transfer[GXFER_ADLER][0])))
+    {
+        gmcp_transfer_status(session, "error", "Checksum mismatch.");
+        return;
     }
 
     switch(file_size(path))
     {
     case -2:
         /* Don't overwrite a directory. */
+        gmcp_transfer_status(session, "error", "Path is a directory.");
         return;
     case -1:
         /* New file, this is good. */
@@ -238,6 +572,7 @@ gmcp_write_file(object player, mixed data)
     case 0:
         /* Overwrite empty file. */
         rm(path);
+        break;
     default:
         /* Just for good measure, keep a backup of the file. */
         while(file_size(path + index) > 0)
@@ -246,7 +581,238 @@ gmcp_write_file(object player, mixed data)
         }
         rename(path, path + index);
     }
-    write_file(path, data[GMCP_TEXT]);
+
+    if (rename(transfer[GXFER_TEMP], path))
+    {
+        gmcp_transfer_status(session, "done", 0);
+        return;
+    }
+    gmcp_transfer_status(session, "error", "Rename failed.");
+}
+
+/*
+ * Function name: gmcp_write_step
+ * Description  : Called from an alarm to write the next waiting chunk of
+ *                every transfer to its temporary file. Transfers of which
+ *                all chunks are written are put in place.
+ */
+public void
+gmcp_write_step()
+{
+    mixed *transfer;
+    int waiting;
+
+    foreach(string session: m_indices(gmcp_transfers))
+    {
+        transfer = gmcp_transfers[session];
+        if (!sizeof(transfer[GXFER_QUEUE]))
+        {
+            continue;
+        }
+
+        set_auth(this_object(), "root:" + transfer[GXFER_NAME]);
+        if (!write_file(transfer[GXFER_TEMP], transfer[GXFER_QUEUE][0]))
+        {
+            gmcp_transfer_status(session, "error", "Write failed.");
+            continue;
+        }
+        transfer[GXFER_QUEUE] = transfer[GXFER_QUEUE][1..];
+
+        if (sizeof(transfer[GXFER_QUEUE]))
+        {
+            waiting = 1;
+        }
+        else if (transfer[GXFER_RECEIVED] == transfer[GXFER_SIZE])
+        {
+            gmcp_commit_file(session);
+        }
+    }
+
+    if (!waiting)
+    {
+        remove_alarm(gmcp_write_alarm);
+        gmcp_write_alarm = 0;
+    }
+}
+
+/*
+ * Function name: gmcp_write_chunk
+ * Description  : Accepts a chunk of a transfer. The offset must be where the
+ *                client was told it should continue and the checksum of the
+ *                chunk must be right. When it is not accepted, the client
+ *                is told the offset to resume from.
+ * Arguments    : string session - the transfer.
+ *                int offset - the offset of the chunk in the file.
+ *                string text - the chunk.
+ *                mixed checksum - the checksum of the chunk, or 0 if the
+ *                    client did not send one.
+ * Returns      : string - the reason it was refused, or 0.
+ */
+static string
+gmcp_write_chunk(string session, int offset, string text, mixed checksum)
+{
+    mixed *transfer = gmcp_transfers[session];
+    int   *state;
+    int    queued;
+
+    if (offset != transfer[GXFER_RECEIVED])
+    {
+        return "Wrong offset.";
+    }
+    if (strlen(text) > GMCP_CHUNK_SIZE ||
+        (offset + strlen(text) > transfer[GXFER_SIZE]))
+    {
+        return "Chunk too large.";
+    }
+
+    foreach(string name, mixed *other: gmcp_transfers)
+    {
+        if (other[GXFER_NAME] == transfer[GXFER_NAME])
+        {
+            foreach(string chunk: other[GXFER_QUEUE])
+            {
+                queued += strlen(chunk);
+            }
+        }
+    }
+    if (queued + strlen(text) > GMCP_TRANSFER_QUEUED)
+    {
+        return "Too much waiting to be written, try again later.";
+    }
+
+    state = gmcp_adler(text, ({ 1, 0 }));
+    if (intp(checksum) && checksum &&
+        (checksum != ((state[1] << 16) | state[0])))
+    {
+        return "Checksum mismatch.";
+    }
+
+    transfer[GXFER_ADLER] = gmcp_adler_append(transfer[GXFER_ADLER], state,
+        strlen(text));
+    transfer[GXFER_RECEIVED] += strlen(text);
+    transfer[GXFER_QUEUE] += ({ text });
+    transfer[GXFER_TIME] = time();
+
+    if (!gmcp_write_alarm)
+    {
+        gmcp_write_alarm = set_alarm(GMCP_WRITE_DELAY, GMCP_WRITE_DELAY,
+            gmcp_write_step);
+    }
+    return 0;
+}
+
+/*
+ * Function name: gmcp_write_file
+ * Description  : Writes a file from the GMCP client. A write is started with
+ *                the path, the size and optionally the checksum of the file
+ *                and the client gets a session to send the chunks with.
+ *                When only a path and text are given, the text is written as
+ *                a transfer of its own.
+ * Arguments    : object player - the player reading the file.
+ *                mixed data - the paramters.
+ */
+static void
+gmcp_write_file(object player, mixed data)
+{
+    string wname = player->query_real_name();
+    string path;
+    string session;
+    string error;
+    mixed *transfer;
+    int size;
+
+    if (!mappingp(data))
+    {
+	return;
+    }
+
+    /* A chunk, resume or abort of a transfer that was started before. */
+    if (stringp(session = data[GMCP_SESSION]))
+    {
+        transfer = gmcp_transfers[session];
+        if (!pointerp(transfer) || (transfer[GXFER_NAME] != wname))
+        {
+            player->catch_gmcp(GMCP_FILES_WRITE_STATUS, ([
+                GMCP_SESSION : session, GMCP_STATUS : "error",
+                GMCP_ERROR : "No such session." ]) );
+            return;
+        }
+        if (data[GMCP_ABORT])
+        {
+            gmcp_transfer_status(session, "error", "Aborted.");
+            return;
+        }
+        if (stringp(data[GMCP_TEXT]) && intp(data[GMCP_OFFSET]) &&
+            stringp(error = gmcp_write_chunk(session, data[GMCP_OFFSET],
+                data[GMCP_TEXT], data[GMCP_CHECKSUM])))
+        {
+            player->catch_gmcp(GMCP_FILES_WRITE_STATUS, ([
+                GMCP_SESSION : session, GMCP_STATUS : "open",
+                GMCP_OFFSET : transfer[GXFER_RECEIVED], GMCP_ERROR : error ]) );
+            return;
+        }
+        gmcp_transfer_status(session, "open", 0);
+        return;
+    }
+
+    /* Access failure. */
+    if (!strlen(data[GMCP_PATH]))
+    {
+	return;
+    }
+    if (stringp(data[GMCP_TEXT]))
+    {
+        size = strlen(data[GMCP_TEXT]);
+    }
+    else if (intp(data[GMCP_SIZE]))
+    {
+        size = data[GMCP_SIZE];
+    }
+    if ((size <= 0) || (size > GMCP_TRANSFER_MAX))
+    {
+	return;
+    }
+    if (sizeof(filter(m_values(gmcp_transfers),
+        &operator(==)(wname) @ &operator([])(, GXFER_NAME))) >=
+        GMCP_TRANSFER_OPEN)
+    {
+        player->catch_gmcp(GMCP_FILES_WRITE_STATUS, ([
+            GMCP_PATH : data[GMCP_PATH], GMCP_STATUS : "error",
+            GMCP_ERROR : "Too many open sessions." ]) );
+        return;
+    }
+
+    set_auth(this_object(), "root:" + wname);
+    /* Ensure path is just a straight path. */
+    path = FTPATH((string)player->query_path(), data[GMCP_PATH]);
+
+    /* Only allow wizards to proceed, just for good measure. */
+    if (!query_wiz_rank(wname) ||
+        !valid_write(path, player, "write") ||
+        (file_size(path) == -2))
+    {
+	return;
+    }
+
+    session = time() + "." + (++gmcp_sessions);
+    gmcp_transfers[session] = ({ wname, path, path + ".gmcp" + session, size,
+        data[GMCP_CHECKSUM], 0, ({ 1, 0 }), ({ }), time() });
+    rm(path + ".gmcp" + session);
+
+    /* The old form with all text in one package. */
+    if (stringp(data[GMCP_TEXT]))
+    {
+        for (int offset = 0; offset < size; offset += GMCP_CHUNK_SIZE)
+        {
+            if (stringp(error = gmcp_write_chunk(session, offset,
+                data[GMCP_TEXT][offset..(offset + GMCP_CHUNK_SIZE - 1)], 0)))
+            {
+                gmcp_transfer_status(session, "error", error);
+                return;
+            }
+        }
+    }
+    gmcp_transfer_status(session, "open", 0);
 }
 
 /*
@@ -320,10 +886,15 @@ process_gmcp(object player, string package, mixed data)
  * Arguments    : object player - the player who sent the gmcp command.
  *                string package - the message identifier / command.
  *                mixed data - the data (optional). Should be a mapping.
+ *                int buffered - if true, the package was buffered during
+ *                    login and already passed the rate limit.
  */
 static void
-incoming_gmcp(object player, string package, mixed data)
+incoming_gmcp(object player, string package, mixed data, int buffered = 0)
 {
+    mixed *stat;
+    int    cost;
+
     if (!objectp(player))
     {
         log_file(LOG_GMCP, ctime(time()) + " No player object.\n", LOG_SIZE_1M);
@@ -337,6 +908,11 @@ incoming_gmcp(object player, string package, mixed data)
     /* Package always has to be lower case. */
     package = lower_case(package);
 
+    if (!buffered && !gmcp_allowed(player))
+    {
+        gmcp_stat(package)[GSTAT_DROPPED]++;
+        return;
+    }
 
     /* During login, all GMCP is buffered in the login object. */
     if (MASTER_OB(player) == LOGIN_OBJECT)
@@ -349,9 +925,9 @@ incoming_gmcp(object player, string package, mixed data)
     if (!IN_ARRAY(package, ({ GMCP_CORE_HELLO, GMCP_CORE_CLIENT, GMCP_CORE_OPTIONS, 
         GMCP_CHAR_VITALS_GET, GMCP_CORE_TOKEN, GMCP_CORE_SUPPORTS_SET }) ))
     {
-        log_file(LOG_GMCP, ctime(time()) + " " + (interactive(player) 
+        gmcp_log_line((interactive(player) 
             ? capitalize(player->query_real_name()) : "<none>") +
-	    ": " + package + "\n", LOG_SIZE_1M);
+	    ": " + package);
     }
 
     /* Give wizards the debug information if they want it. */
@@ -362,7 +938,11 @@ incoming_gmcp(object player, string package, mixed data)
         dump_array(data);
     }
 
+    stat = gmcp_stat(package);
+    cost = EVAL_COST;
     process_gmcp(player, package, data);
+    stat[GSTAT_COST] += EVAL_COST - cost;
+    stat[GSTAT_COUNT]++;
 }
 
 /*
@@ -380,6 +960,86 @@ buffered_gmcp(object player, string package, mixed data)
     /* Only accept calls from the login object. */
     if (IN_ARRAY(mfile, ({ LOGIN_OBJECT, LOGIN_NEW_PLAYER }) ))
     {
-        incoming_gmcp(player, package, data);
+        incoming_gmcp(player, package, data, 1);
+    }
+}
+
+/*
+ * Function name: sort_gmcp_stats
+ * Description  : Sorts the rows of the GMCP report on a column, highest first.
+ */
+static int
+sort_gmcp_stats(int column, mixed *a, mixed *b)
+{
+    return ((a[column] == b[column]) ? 0 : ((a[column] > b[column]) ? -1 : 1));
+}
+
+/*
+ * Function name: query_gmcp_stats
+ * Description  : Gives the number of packages received per GMCP package, with
+ *                their cost and the packages dropped by the rate limit, and
+ *                the connections that are being limited.
+ * Arguments    : string order - sort on "count", "cost" or "dropped".
+ * Returns      : string - the report.
+ */
+public string
+query_gmcp_stats(string order = "count")
+{
+    mixed *rows = ({ });
+    string text;
+    int    column;
+
+    foreach(string package, mixed *stat: gmcp_stats)
+    {
+        rows += ({ ({ package }) + stat });
     }
+
+    column = member_array(order, ({ "count", "cost", "dropped" }));
+    column = ((column == -1) ? GSTAT_COUNT : column) + 1;
+    rows = sort_array(rows, &sort_gmcp_stats(column));
+
+    text = sprintf("GMCP since %s, rate %d/s, burst %d.\n" +
+        "%-30s %8s %10s %10s %8s\n", ctime(gmcp_stats_time),
+        ftoi(GMCP_RATE), ftoi(GMCP_BURST), "Package", "Count", "Eval/msg",
+        "Eval", "Dropped");
+    foreach(mixed *row: rows)
+    {
+        text += sprintf("%-30s %8d %10d %10d %8d\n", row[0],
+            row[GSTAT_COUNT + 1],
+            (row[GSTAT_COUNT + 1] ? (row[GSTAT_COST + 1] /
+                row[GSTAT_COUNT + 1]) : 0),
+            row[GSTAT_COST + 1], row[GSTAT_DROPPED + 1]);
+    }
+
+    foreach(object player, mixed *bucket: gmcp_buckets)
+    {
+        if (objectp(player) && bucket[BUCKET_DROPPED])
+        {
+            text += sprintf("Limited: %-11s %d packages dropped in a row.\n",
+                capitalize(bucket[BUCKET_NAME] || "<none>"),
+                bucket[BUCKET_DROPPED]);
+        }
+    }
+
+    text += sprintf("Log buffer: %d of %d lines waiting.\n", gmcp_log_size,
+        GMCP_LOG_RING);
+    return text;
+}
+
+/*
+ * Function name: clear_gmcp_stats
+ * Description  : Forgets the GMCP statistics. Only wizards may do this.
+ * Returns      : int 1/0 - success/failure.
+ */
+public int
+clear_gmcp_stats()
+{
+    if (query_wiz_rank(this_interactive()->query_real_name()) < WIZ_NORMAL)
+    {
+        return 0;
+    }
+
+    gmcp_stats = ([ ]);
+    gmcp_stats_time = time();
+    return 1;
 }
@@ -536,6 +536,9 @@ notify(object ob, int level)
     string domain = query_wiz_dom(name);
     int    ld = (level >= CONNECT_LINKDIE);
 
+    /* Keep the presence registry for the 'who' command up to date. */
+    PRESENCE_CENTRAL->notify_presence(ob, level);
+
     switch(level)
     {
     case CONNECT_LOGIN:
@@ -28,9 +28,16 @@ private mapping sitebans;
  *
  * sitebans_nologin = (string *)ipmasks
  * sitebans_nonew   = (string *)ipmasks
+ * siteban_index    = the index of all sitebans, see make_siteban_index().
  */
 private static string *sitebans_nologin;
 private static string *sitebans_nonew;
+private static mixed   siteban_index;
+
+#define INDEX_TRIE      0
+#define INDEX_CIDR      1
+#define INDEX_NOLOGIN   2
+#define INDEX_NONEW     3
 
 /*
  * Function name: filter_sitebans
@@ -45,11 +52,214 @@ filter_sitebans(string ipmask, int type)
     return (sitebans[ipmask][SITEBAN_TYPE] == type);
 }
 
+/*
+ * Function name: ip_octets
+ * Description  : Splits an ip number into its four octets.
+ * Arguments    : string ipnumber - the ip number, like "10.1.2.3".
+ * Returns      : int * - the octets, or 0 if it is not an ip number.
+ */
+static int *
+ip_octets(string ipnumber)
+{
+    int *octets = allocate(4);
+
+    if ((sscanf(ipnumber, "%d.%d.%d.%d", octets[0], octets[1], octets[2],
+        octets[3]) != 4) ||
+        (implode(map(octets, &operator(+)("")), ".") != ipnumber) ||
+        sizeof(filter(octets, &operator(<)(255))) ||
+        sizeof(filter(octets, &operator(>)(0))))
+    {
+        return 0;
+    }
+
+    return octets;
+}
+
+/*
+ * Function name: ip_value
+ * Description  : Gives the numeric value of an ip number.
+ * Arguments    : int *octets - the octets of the ip number.
+ * Returns      : int - the value.
+ */
+static int
+ip_value(int *octets)
+{
+    return (octets[0] << 24) | (octets[1] << 16) | (octets[2] << 8) |
+        octets[3];
+}
+
+/*
+ * Function name: cidr_mask
+ * Description  : Gives the mask of a network with a number of bits.
+ * Arguments    : int bits - the number of bits, 0 - 32.
+ * Returns      : int - the mask.
+ */
+static int
+cidr_mask(int bits)
+{
+    return (bits ? ((0xffffffff << (32 - bits)) & 0xffffffff) : 0);
+}
+
+/*
+ * Function name: strongest_ban
+ * Description  : Gives the strongest of two bans, nologin before nonew.
+ * Arguments    : int a, b - the bans, 0 for none.
+ * Returns      : int - the strongest ban.
+ */
+static int
+strongest_ban(int a, int b)
+{
+    if (!a)
+        return b;
+
+    if (!b)
+        return a;
+
+    return min(a, b);
+}
+
+/*
+ * Function name: make_siteban_index
+ * Description  : Builds the index of a list of sitebans, so that an ip
+ *                number can be checked without matching every mask.
+ *                Masks of whole octets, like "10.1.*" or "10.1.2.3", go
+ *                into a trie of octets. Networks like "10.1.0.0/16" go into
+ *                a table per number of bits. All other masks are kept in
+ *                lists and are matched with wildmatch() as before.
+ * Arguments    : mapping bans - ([ (string) ipmask : ({ (int) type, ... }) ])
+ * Returns      : mixed - ({ trie, networks, nologin masks, nonew masks })
+ *                  trie     = ([ (string) octet : node, "*" : (int) type ])
+ *                  networks = ([ (int) bits : ([ (int) network : type ]) ])
+ */
+public mixed
+make_siteban_index(mapping bans)
+{
+    mixed   index = ({ ([ ]), ([ ]), ({ }), ({ }) });
+    mapping node;
+    string *parts;
+    int    *octets;
+    int     bits;
+    int     type;
+    int     size;
+    string  network;
+
+    foreach(string ipmask, mixed data: bans)
+    {
+        type = data[SITEBAN_TYPE];
+
+        /* A network in CIDR notation. */
+        if ((sscanf(ipmask, "%s/%d", network, bits) == 2) &&
+            (bits >= 0) && (bits <= 32) &&
+            (ipmask == (network + "/" + bits)) &&
+            pointerp(octets = ip_octets(network)))
+        {
+            if (!mappingp(index[INDEX_CIDR][bits]))
+            {
+                index[INDEX_CIDR][bits] = ([ ]);
+            }
+            index[INDEX_CIDR][bits][ip_value(octets) & cidr_mask(bits)] =
+                strongest_ban(index[INDEX_CIDR][bits][ip_value(octets) &
+                cidr_mask(bits)], type);
+            continue;
+        }
+
+        /* Whole octets, either ending in ".*" or a complete ip number. */
+        parts = explode(ipmask, ".");
+        size = sizeof(parts);
+        if ((size >= 2) && (size <= 4) && (parts[size - 1] == "*"))
+        {
+            parts = parts[..(size - 2)];
+        }
+        else if (size != 4)
+        {
+            parts = 0;
+        }
+
+        if (pointerp(parts) &&
+            pointerp(ip_octets(implode((parts + ({ "0", "0", "0" }))[..3],
+            "."))))
+        {
+            node = index[INDEX_TRIE];
+            foreach(string octet: parts)
+            {
+                if (!mappingp(node[octet]))
+                {
+                    node[octet] = ([ ]);
+                }
+                node = node[octet];
+            }
+            node["*"] = strongest_ban(node["*"], type);
+            continue;
+        }
+
+        /* Anything else is matched as before. */
+        if (type == SITEBAN_NOLOGIN)
+        {
+            index[INDEX_NOLOGIN] += ({ ipmask });
+        }
+        else
+        {
+            index[INDEX_NONEW] += ({ ipmask });
+        }
+    }
+
+    return index;
+}
+
+/*
+ * Function name: match_siteban_index
+ * Description  : Finds the strongest ban on an ip number in an index.
+ * Arguments    : mixed index - the index, see make_siteban_index().
+ *                string ipnumber - the ip number to check.
+ * Returns      : int - 0, SITEBAN_NOLOGIN or SITEBAN_NONEW.
+ */
+public int
+match_siteban_index(mixed index, string ipnumber)
+{
+    mixed   node;
+    int    *octets;
+    int     value;
+    int     found;
+
+    if (pointerp(octets = ip_octets(ipnumber)))
+    {
+        node = index[INDEX_TRIE];
+        foreach(int octet: octets)
+        {
+            if (!mappingp(node = node["" + octet]))
+            {
+                break;
+            }
+            found = strongest_ban(found, node["*"]);
+        }
+
+        value = ip_value(octets);
+        foreach(int bits, mapping networks: index[INDEX_CIDR])
+        {
+            found = strongest_ban(found, networks[value & cidr_mask(bits)]);
+        }
+    }
+
+    if (found == SITEBAN_NOLOGIN)
+        return SITEBAN_NOLOGIN;
+
+    if (sizeof(filter(index[INDEX_NOLOGIN], &wildmatch(, ipnumber))))
+        return SITEBAN_NOLOGIN;
+
+    if (found)
+        return found;
+
+    if (sizeof(filter(index[INDEX_NONEW], &wildmatch(, ipnumber))))
+        return SITEBAN_NONEW;
+
+    return 0;
+}
+
 /*
  * Function name: init_sitebans
  * Description  : Called at boot-time, and whenever the sitebans list has been
  *                updated to create separate lists of sites that have been
- *                banned nonew or nologin.
+ *                banned nonew or nologin, and the index to check them.
  */
 static void
 init_sitebans()
@@ -63,6 +273,7 @@ init_sitebans()
         &filter_sitebans(, SITEBAN_NOLOGIN));
     sitebans_nonew = filter(m_indices(sitebans),
         &filter_sitebans(, SITEBAN_NONEW));
+    siteban_index = make_siteban_index(sitebans);
 }
 
 /*
@@ -79,13 +290,7 @@ check_newplayer(string ipnumber)
     if (!strlen(ipnumber))
         return 0;
 
-    if (sizeof(filter(sitebans_nologin, &wildmatch(, ipnumber))))
-        return SITEBAN_NOLOGIN;
-
-    if (sizeof(filter(sitebans_nonew, &wildmatch(, ipnumber))))
-        return SITEBAN_NONEW;
-
-    return 0;
+    return match_siteban_index(siteban_index, ipnumber);
 }
 
 /*
@@ -28,12 +28,30 @@ inherit "/lib/cache";
 #define LC(str)         lower_case((str))
 #define UC(str)         capitalize(lower_case((str)))
 
+/*
+ * The boards are saved in shards, one per category, in this directory. The
+ * boards that are not in a category share a shard.
+ */
+#define SHARD_DIR       (SAVE_MC + "_boards/")
+#define SHARD_NAME(cat) (strlen(cat) ? (cat) : "_unnamed")
+#define SHARD_DELAY     (10.0)  /* Delay before a changed shard is saved */
+
+#define SHARD_BOARDS    0       /* Number of boards in the shard */
+#define SHARD_BYTES     1       /* Size of the save file */
+#define SHARD_SAVES     2       /* Number of saves since the reboot */
+#define SHARD_COST      3       /* Total eval cost of saving */
+#define SHARD_MAX       4       /* Highest eval cost of a save */
+
+#define LOAD_COUNT      0       /* Number of boards loaded */
+#define LOAD_FAILED     1       /* Number of boards that failed to load */
+#define LOAD_COST       2       /* Total eval cost of loading */
+#define LOAD_MAX        3       /* Highest eval cost of a load */
+
 /*
  * Globals, saved
  */
 string          *AdminList;     // The list of trusted admins
 mapping         CategoryMap,    // The mapping of categories
-                BbpMap,         // Board by path map
                 BrokenMap,      // The mapping of broken boards
                 UnusedMap;      // The mapping of unused boards
 int             ReportTime,     // Last time a report was made
@@ -43,10 +61,14 @@ mapping         HelpMap;        // Contains indices in the help map file.
 /*
  * Globals, static
  */
+static mapping  BbpMap;         // Board by path map, saved in shards
 static mapping  BbcMap;         // Board by category map
 static mapping  BbdMap;         // Board by domain map
-static int      SaveCount;      // Save count for saving read board info
 static int      SaveAlarm;      // Save alarm id
+static mapping  DirtyShards;    // Shards changed since they were saved
+static int      ShardAlarm;     // Shard save alarm id
+static mapping  ShardStats;     // Statistics per shard, see SHARD_*
+static mixed    LoadStats;      // Statistics of board loading, see LOAD_*
 static int      IndexLine,      // The current index line.
                 CountLine,      // The number of lines in a help text.
                 HelpAlarmId;    // The id-number of the alarm used.
@@ -65,6 +87,10 @@ static mapping  BobMap;         // Board object mapping
  *      = list of BbpMap value lists = ])
  *
  * BrokenMap, UnusedMap : ([ "save path" : time stamp ]);
+ *
+ * DirtyShards : ([ "shard" : 1 ])
+ *
+ * ShardStats : ([ "shard" : ({ boards, bytes, saves, time, max time }) ])
  */
 
 /*
@@ -108,6 +134,10 @@ static nomask void      autosave_mbs();
 static nomask void      dosave();
 static nomask void      index_help(int cmd);
 static nomask void      check_integrity();
+static nomask void      restore_shards();
+static nomask void      mark_dirty(string spath);
+static nomask void      mark_all_dirty();
+static nomask void      save_shards(int all);
 nomask static void      debug_out(string str);
 
 /*
@@ -118,7 +148,6 @@ public nomask void
 create()
 {
     string *avail;
-    mapping load_map;
 
     if (IS_CLONE)
     {
@@ -136,7 +165,12 @@ create()
     BbpMap = BbcMap = BbdMap = BrokenMap = UnusedMap = ([]);
     HelpMap = ([]);
 
+    DirtyShards = ([]);
+    ShardStats = ([]);
+    LoadStats = ({ 0, 0, 0, 0 });
+
     restore_object(SAVE_MC);
+    restore_shards();
     check_integrity();
 
     if (ReportTime == 0)
@@ -144,13 +178,9 @@ create()
 
     update_bbmaps();
 
-    SaveCount = 1;
     SaveAlarm = set_alarm(300.0, 300.0, autosave_mbs);
 
-    /* Load all boards, but slowly */
-    load_map = filter(BbpMap, strlen @ &operator([])(, BBP_BOARD));
     BobMap = ([]);
-    load_all_boards(m_indexes(load_map));
 
     /*
      * Update the broken/unused maps
@@ -163,6 +193,12 @@ create()
     avail = filter(avail, sizeof @ &operator([])(BbpMap, ));
     UnusedMap = mkmapping(avail, map(avail, &operator([])(UnusedMap, )));
 
+    /*
+     * Boards are loaded when they are first used. Only the boards that
+     * were broken are tried again, slowly, so they can be cleaned up.
+     */
+    load_all_boards(m_indexes(BrokenMap));
+
     /*
      * Initialize the cache
      */
@@ -375,9 +411,11 @@ add_board(string *data)
     /*
      * All demands are met, add it.
      */
+    mark_dirty(data[2]);
     BbpMap[data[2]][BBP_BOARD] = data[0];
     BbpMap[data[2]][BBP_CAT] = data[1];
     BbpMap[data[2]][BBP_DESC] = data[3];
+    mark_dirty(data[2]);
 
     write("Added the board '" + data[0] + "' to the category '" +
         data[1] + "'.\n");
@@ -434,6 +472,7 @@ remove_board(string board, string cath, int all)
 
     /* Everything checks out, remove the board */
 
+    mark_dirty(bdata[BBP_SPATH]);
     if (all)
     {
         m_delkey(BbpMap, bdata[BBP_SPATH]);
@@ -444,6 +483,7 @@ remove_board(string board, string cath, int all)
         BbpMap[bdata[BBP_SPATH]][BBP_BOARD] = "";
         BbpMap[bdata[BBP_SPATH]][BBP_CAT] = "";
         BbpMap[bdata[BBP_SPATH]][BBP_DESC] = "";
+        mark_dirty(bdata[BBP_SPATH]);
     }
 
     /*
@@ -507,6 +547,7 @@ remove_central_entry(string entry)
     }
 
     /* All is ok, remove it */
+    mark_dirty(entry);
     m_delkey(BbpMap, entry);
     if (BrokenMap[entry])
         m_delkey(BrokenMap, entry);
@@ -584,6 +625,7 @@ rename_board(string old, string cath, string new, string ndesc)
         write("Renamed the board '" + old + "' in the category '" + cath +
             "' to '" + new + "'.\n");
         BbpMap[bdata[BBP_SPATH]][BBP_BOARD] = new;
+        mark_dirty(bdata[BBP_SPATH]);
         logit("Board rename [" + UC(TI->query_real_name()) + "] " + old +
             "(" + cath + ") -> " + new);
         GcTime = time();
@@ -600,6 +642,7 @@ rename_board(string old, string cath, string new, string ndesc)
             write("Changed the description of the board '" + old +
                 "' in the category '" + cath + "' to '" + ndesc + "'.\n");
             BbpMap[bdata[BBP_SPATH]][BBP_DESC] = ndesc;
+            mark_dirty(bdata[BBP_SPATH]);
         }
     }
 
@@ -645,6 +688,7 @@ list_new_boards(string dom = "")
         map(sort_array(discard), &write() @ &sprintf("%s\n", ));
         discard_list = map(discard, &mk_discard_list());
         mail_notify(M_E_REMOVED, discard_list);
+        map(discard, mark_dirty);
         remains = m_indexes(BbpMap) - discard;
         BbpMap = mkmapping(remains, map(remains, &operator([])(BbpMap, )));
         dosave();
@@ -980,7 +1024,11 @@ rename_category(string old, string new, string ndesc)
 
         bds = BbcMap[old];
         for (i = 0, sz = sizeof(bds) ; i < sz ; i++)
+        {
+            mark_dirty(bds[i][BBP_SPATH]);
             bds[i][BBP_CAT] = new;
+            mark_dirty(bds[i][BBP_SPATH]);
+        }
         update_bbmaps();
         write("Renamed category '" + old + "' to '" +
               new + "'.\n");
@@ -1060,6 +1108,40 @@ tele_to_board(string spath)
     return MBM_NO_ERR;
 }
 
+/*
+ * Function name: report_shards
+ * Description:   Report on the shards the boards are saved in and on the
+ *                loading of boards since the reboot.
+ * Returns:       The report
+ */
+static nomask string
+report_shards()
+{
+    string text;
+    mixed stats;
+
+    text = sprintf("%-12s %6s %8s %5s %9s %9s %5s\n", "Shard", "Boards",
+        "Bytes", "Saves", "Avg cost", "Max cost", "Dirty");
+    foreach(string name: sort_array(m_indexes(ShardStats)))
+    {
+        stats = ShardStats[name];
+        text += sprintf("%-12s %6d %8d %5d %9d %9d %5s\n", name,
+            stats[SHARD_BOARDS], stats[SHARD_BYTES], stats[SHARD_SAVES],
+            (stats[SHARD_SAVES] ?
+                (stats[SHARD_COST] / stats[SHARD_SAVES]) : 0),
+            stats[SHARD_MAX], (DirtyShards[name] ? "yes" : "no"));
+    }
+
+    text += sprintf("\nBoards loaded: %d of %d, %d failed, " +
+        "avg cost %d, max cost %d.\n", m_sizeof(filter(BobMap, objectp)),
+        m_sizeof(BbpMap), LoadStats[LOAD_FAILED],
+        (LoadStats[LOAD_COUNT] ?
+            (LoadStats[LOAD_COST] / LoadStats[LOAD_COUNT]) : 0),
+        LoadStats[LOAD_MAX]);
+
+    return text;
+}
+
 /*
  * Function name: generate_report
  * Description:   Generate a usage report
@@ -1074,6 +1156,12 @@ generate_report(int what)
     if (CALL_CHECK)
         return MBM_BAD_CALL;
 
+    if (what == 5)
+    {
+        write(report_shards());
+        return MBM_NO_ERR;
+    }
+
     blist = m_values(BbpMap);
     blist = filter(blist, &operator(!=)(0) @ strlen @
                    &operator([])(, BBP_BOARD));
@@ -1115,6 +1203,7 @@ generate_report(int what)
     case 2:
         ReportTime = time();
         map(blist, reset_usage_info);
+        mark_all_dirty();
         write("All statistics erased.\n");
         return MBM_NO_ERR;
         break;
@@ -1695,7 +1784,7 @@ new_note(string save_path, string last_note, string room_path)
     if (room_path != BbpMap[save_path][BBP_RPATH])
         BbpMap[save_path][BBP_RPATH] = room_path;
 
-    dosave();
+    mark_dirty(save_path);
 }
 
 /*
@@ -1711,9 +1800,7 @@ read_note(string save_path)
         return;
 
     BbpMap[save_path][BBP_RNOTE] += 1;
-
-    if (!(SaveCount++ % 100))
-        dosave();
+    mark_dirty(save_path);
 }
 
 /*
@@ -1736,9 +1823,7 @@ remove_note(string save_path)
 
     BbpMap[save_path][BBP_LNOTE] = board->query_latest_note();
     BbpMap[save_path][BBP_PNOTE] -= 1;
-
-    if (!(SaveCount++ % 100))
-        dosave();
+    mark_dirty(save_path);
 }
 
 /*
@@ -1761,7 +1846,160 @@ static nomask void
 autosave_mbs()
 {
     save_object(SAVE_MC);
-    SaveCount = 1;
+}
+
+/*
+ * Function name: shard_of
+ * Description:   Find the shard a board is saved in.
+ * Arguments:     data - the board entry
+ * Returns:       The name of the shard
+ */
+static nomask string
+shard_of(mixed data)
+{
+    return SHARD_NAME(data[BBP_CAT]);
+}
+
+/*
+ * Function name: restore_shards
+ * Description:   Restore the boards from their shards. If there are no
+ *                shards yet, take the boards from the old save file, where
+ *                they were all saved together, and write the shards.
+ */
+static nomask void
+restore_shards()
+{
+    mapping shard;
+    string name;
+
+    BbpMap = ([]);
+
+    if (file_size(SHARD_DIR) != -2)
+    {
+        mkdir(SHARD_DIR[..-2]);
+        if (file_size(SAVE_MC + ".o") > 0)
+            shard = restore_map(SAVE_MC)["BbpMap"];
+        if (mappingp(shard))
+            BbpMap = shard;
+        mark_all_dirty();
+        save_shards(1);
+        save_object(SAVE_MC);
+        return;
+    }
+
+    foreach(string file: get_dir(SHARD_DIR))
+    {
+        if (!wildmatch("*.o", file))
+            continue;
+
+        name = file[..-3];
+        shard = restore_map(SHARD_DIR + name);
+        if (!mappingp(shard))
+            continue;
+
+        BbpMap += shard;
+        ShardStats[name] = ({ m_sizeof(shard), file_size(SHARD_DIR + file),
+                              0, 0, 0 });
+    }
+}
+
+/*
+ * Function name: mark_dirty
+ * Description:   Mark the shard of a board as changed, so it is saved in
+ *                the background. Call it both before and after the category
+ *                of a board is changed.
+ * Arguments:     spath - the board save path
+ */
+static nomask void
+mark_dirty(string spath)
+{
+    if (!pointerp(BbpMap[spath]))
+        return;
+
+    DirtyShards[shard_of(BbpMap[spath])] = 1;
+
+    if (!ShardAlarm)
+        ShardAlarm = set_alarm(SHARD_DELAY, 0.0, &save_shards(0));
+}
+
+/*
+ * Function name: mark_all_dirty
+ * Description:   Mark all shards as changed.
+ */
+static nomask void
+mark_all_dirty()
+{
+    foreach(string name: m_indexes(ShardStats))
+        DirtyShards[name] = 1;
+
+    foreach(string spath: m_indexes(BbpMap))
+        mark_dirty(spath);
+}
+
+/*
+ * Function name: save_shard
+ * Description:   Save the boards of one shard. An empty shard is removed.
+ * Arguments:     name - the shard
+ */
+static nomask void
+save_shard(string name)
+{
+    mapping boards;
+    mixed stats;
+    int cost;
+
+    cost = EVAL_COST;
+    boards = filter(BbpMap, &operator(==)(name) @ shard_of);
+    m_delkey(DirtyShards, name);
+
+    if (!m_sizeof(boards))
+    {
+        rm(SHARD_DIR + name + ".o");
+        m_delkey(ShardStats, name);
+        return;
+    }
+
+    save_map(boards, SHARD_DIR + name);
+    cost = EVAL_COST - cost;
+
+    if (!pointerp(stats = ShardStats[name]))
+        stats = ShardStats[name] = ({ 0, 0, 0, 0, 0 });
+    stats[SHARD_BOARDS] = m_sizeof(boards);
+    stats[SHARD_BYTES] = file_size(SHARD_DIR + name + ".o");
+    stats[SHARD_SAVES]++;
+    stats[SHARD_COST] += cost;
+    if (cost > stats[SHARD_MAX])
+        stats[SHARD_MAX] = cost;
+}
+
+/*
+ * Function name: save_shards
+ * Description:   Save the shards that changed. In the background one shard
+ *                is saved at a time, so a burst of changes does not stall
+ *                the game.
+ * Arguments:     all - if true, save all changed shards at once
+ */
+static nomask void
+save_shards(int all)
+{
+    string *names;
+
+    if (ShardAlarm)
+        remove_alarm(ShardAlarm);
+    ShardAlarm = 0;
+    names = m_indexes(DirtyShards);
+    if (!sizeof(names))
+        return;
+
+    if (all)
+    {
+        map(names, save_shard);
+        return;
+    }
+
+    save_shard(names[0]);
+    if (sizeof(names) > 1)
+        ShardAlarm = set_alarm(1.0, 0.0, &save_shards(0));
 }
 
 /*
@@ -1871,7 +2109,9 @@ query_board_access(string bspath)
 /*
  * Function name: find_board
  * Description:   Find a board in the central board handler, return
- *                its object pointer.
+ *                its object pointer. Boards are loaded when they are first
+ *                asked for. A board that fails to load is checked for
+ *                being broken in the background.
  * Arguments:     bspath - board storage path
  * Returns:       The object pointer to the board, if any
  */
@@ -1879,8 +2119,8 @@ static nomask object
 find_board(string bspath)
 {
     string broom;
-    object *obs;
-    int i;
+    object *obs, bd;
+    int i, cost;
 
     if (!mappingp(BobMap))
         BobMap = ([]);
@@ -1893,20 +2133,31 @@ find_board(string bspath)
     if (!BbpMap[bspath])
         return 0;
 
+    cost = EVAL_COST;
     broom = BbpMap[bspath][BBP_RPATH];
 
-    if (LOAD_ERR(broom))
-        return 0;
+    if (!LOAD_ERR(broom))
+    {
+        obs = all_inventory(find_object(broom));
+
+        if ((i = member_array(bspath, obs->query_board_name())) >= 0)
+            bd = BobMap[bspath] = obs[i];
+    }
 
-    obs = all_inventory(find_object(broom));
+    cost = EVAL_COST - cost;
+    LoadStats[LOAD_COUNT]++;
+    LoadStats[LOAD_COST] += cost;
+    if (cost > LoadStats[LOAD_MAX])
+        LoadStats[LOAD_MAX] = cost;
 
-    if ((i = member_array(bspath, obs->query_board_name())) >= 0)
+    if (!objectp(bd))
     {
-        BobMap[bspath] = obs[i];
-        return obs[i];
+        LoadStats[LOAD_FAILED]++;
+        if (!BrokenMap[bspath] && strlen(BbpMap[bspath][BBP_BOARD]))
+            set_alarm(0.0, 0.0, &load_all_boards(({ bspath })));
     }
 
-    return 0;
+    return bd;
 }
 
 /*
@@ -2271,6 +2522,7 @@ load_all_boards(string *list)
             GcTime = time();
             logit("Board delete broken [Auto] " +
                 BbpMap[list[0]][BBP_BOARD] + ":" + BbpMap[list[0]][BBP_CAT]);
+            mark_dirty(list[0]);
             m_delkey(BbpMap, list[0]);
             dosave();
         }
@@ -2305,6 +2557,7 @@ load_all_boards(string *list)
                 m_delkey(UnusedMap, list[0]);
                 GcTime = time();
                 logit("Board delete idle [Auto] " + BbpMap[list[0]][BBP_BOARD] + ":" + BbpMap[list[0]][BBP_CAT]);
+                mark_dirty(list[0]);
                 m_delkey(BbpMap, list[0]);
                 dosave();
             }
@@ -2387,6 +2640,7 @@ public nomask void
 remove_object()
 {
     dosave();
+    save_shards(1);
     destruct();
 }
 
@@ -0,0 +1,614 @@
+/*
+ * /secure/presence.c
+ *
+ * This object keeps track of the players in the game. It is updated when
+ * people log in, log out, linkdie, revive, change wizard rank or turn
+ * (in)visible. Invisibility set directly with add_prop(OBJ_I_INVIS) is
+ * picked up when the invisible category is asked for. For each category
+ * of players a sorted list of names is kept, so that the 'who' command can
+ * be answered with set operations on those lists rather than by scanning
+ * and sorting all users.
+ *
+ * The categories are defined in <const.h>:
+ *
+ *   PRESENCE_MORTAL   - mortal players;
+ *   PRESENCE_WIZARD   - players with a wizard rank;
+ *   PRESENCE_JUNIOR   - junior characters;
+ *   PRESENCE_INVIS    - invisible wizards;
+ *   PRESENCE_LINKDEAD - players without a connection.
+ */
+
+#pragma no_clone
+#pragma no_inherit
+#pragma save_binary
+#pragma strict_types
+
+#include <const.h>
+#include <files.h>
+#include <macros.h>
+#include <std.h>
+#include <stdproperties.h>
+
+/*
+ * Global variables. They are not saved.
+ *
+ * players    - ([ (string) name : (object) player ])
+ * categories - ([ (string) name : (int) category flags ])
+ * names      - the sorted names of all players in the game.
+ * lists      - ([ (int) category : (string *) sorted names ])
+ * counts     - ([ (int) category flags : (int) number of players ])
+ * updates    - the number of updates processed since the last reboot.
+ * queries    - the number of name lists handed out since the last reboot.
+ */
+private static mapping players    = ([ ]);
+private static mapping categories = ([ ]);
+private static string *names      = ({ });
+private static mapping lists      = ([ ]);
+private static mapping counts     = ([ ]);
+private static int     updates;
+private static int     queries;
+
+/*
+ * Prototype.
+ */
+public void rebuild();
+
+/*
+ * Function name: create
+ * Description  : Constructor. Builds the registry from the people who are
+ *                currently in the game.
+ */
+public void
+create()
+{
+    setuid();
+    seteuid(getuid());
+
+    rebuild();
+}
+
+/*
+ * Function name: insert_sorted
+ * Description  : Adds a name to a sorted list of names, keeping it sorted.
+ *                The position is found by binary search.
+ * Arguments    : string *list - the sorted list.
+ *                string name  - the name to add.
+ * Returns      : string * - the new list.
+ */
+static string *
+insert_sorted(string *list, string name)
+{
+    int low = 0;
+    int high = sizeof(list);
+    int mid;
+
+    while (low < high)
+    {
+        mid = (low + high) / 2;
+        if (list[mid] < name)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    if ((low < sizeof(list)) && (list[low] == name))
+    {
+        return list;
+    }
+
+    return (low ? list[..(low - 1)] : ({ })) + ({ name }) + list[low..];
+}
+
+/*
+ * Function name: set_categories
+ * Description  : Stores the categories of a player and moves the name in
+ *                or out of the sorted category lists as necessary.
+ * Arguments    : string name - the name of the player.
+ *                int flags   - the new category flags.
+ */
+static void
+set_categories(string name, int flags)
+{
+    int old_flags = categories[name];
+
+    if (old_flags)
+    {
+        counts[old_flags] = counts[old_flags] - 1;
+    }
+    if (flags)
+    {
+        counts[flags] = counts[flags] + 1;
+    }
+
+    foreach(int category: PRESENCE_CATEGORIES)
+    {
+        if ((flags & category) == (old_flags & category))
+        {
+            continue;
+        }
+
+        if (flags & category)
+        {
+            lists[category] = insert_sorted(lists[category], name);
+        }
+        else
+        {
+            lists[category] -= ({ name });
+        }
+    }
+
+    categories[name] = flags;
+}
+
+/*
+ * Function name: compute_categories
+ * Description  : Finds out in which categories a player belongs.
+ * Arguments    : object player - the player.
+ *                int linkdead  - true if the player is without connection.
+ * Returns      : int - the category flags.
+ */
+static int
+compute_categories(object player, int linkdead)
+{
+    string name = player->query_real_name();
+    int flags;
+
+    if (SECURITY->query_wiz_rank(name) > WIZ_MORTAL)
+    {
+        flags = PRESENCE_WIZARD;
+        if (player->query_prop(OBJ_I_INVIS) >= 100)
+        {
+            flags |= PRESENCE_INVIS;
+        }
+    }
+    else
+    {
+        flags = PRESENCE_MORTAL;
+    }
+
+    if (wildmatch("*jr", name))
+    {
+        flags |= PRESENCE_JUNIOR;
+    }
+
+    if (linkdead)
+    {
+        flags |= PRESENCE_LINKDEAD;
+    }
+
+    return flags;
+}
+
+/*
+ * Function name: add_player
+ * Description  : Adds a player to the registry, or updates its categories
+ *                if it is already known.
+ * Arguments    : object player - the player.
+ *                int linkdead  - true if the player is without connection.
+ */
+static void
+add_player(object player, int linkdead)
+{
+    string name = player->query_real_name();
+
+    if (!strlen(name))
+    {
+        return;
+    }
+
+    if (!players[name])
+    {
+        names = insert_sorted(names, name);
+    }
+    players[name] = player;
+    set_categories(name, compute_categories(player, linkdead));
+}
+
+/*
+ * Function name: remove_player
+ * Description  : Removes a player from the registry.
+ * Arguments    : string name - the name of the player.
+ */
+static void
+remove_player(string name)
+{
+    set_categories(name, 0);
+    m_delkey(categories, name);
+    m_delkey(players, name);
+    names -= ({ name });
+}
+
+/*
+ * Function name: validate_presence
+ * Description  : Players may be destructed without logging out properly.
+ *                Their entries are removed here.
+ */
+static void
+validate_presence()
+{
+    if (member_array(0, m_values(players)) == -1)
+    {
+        return;
+    }
+
+    foreach(string name: m_indices(players))
+    {
+        if (!objectp(players[name]))
+        {
+            remove_player(name);
+        }
+    }
+}
+
+/*
+ * Function name: validate_invis
+ * Description  : Wizards may turn (in)visible with add_prop(OBJ_I_INVIS)
+ *                rather than with set_invis(), which does not tell us. The
+ *                invisible category of all wizards is checked here before
+ *                it is used. There are few wizards, so this is cheap.
+ */
+static void
+validate_invis()
+{
+    object player;
+    int    flags;
+
+    foreach(string name: lists[PRESENCE_WIZARD])
+    {
+        if (!objectp(player = players[name]))
+        {
+            continue;
+        }
+
+        flags = categories[name] & ~PRESENCE_INVIS;
+        if (player->query_prop(OBJ_I_INVIS) >= 100)
+        {
+            flags |= PRESENCE_INVIS;
+        }
+
+        if (flags != categories[name])
+        {
+            updates++;
+            set_categories(name, flags);
+        }
+    }
+}
+
+/*
+ * Function name: rebuild
+ * Description  : Clears the registry and rebuilds it from the players who
+ *                are in the game. This includes linkdead players if they
+ *                are kept in the statue room.
+ */
+public void
+rebuild()
+{
+    object *list = FILTER_PLAYER_OBJECTS(users() - ({ 0 }) );
+    object room;
+
+    players = ([ ]);
+    categories = ([ ]);
+    names = ({ });
+    lists = ([ ]);
+    counts = ([ ]);
+    foreach(int category: PRESENCE_CATEGORIES)
+    {
+        lists[category] = ({ });
+    }
+
+#ifdef STATUE_WHEN_LINKDEAD
+#ifdef OWN_STATUE
+    if (objectp(room = find_object(OWN_STATUE)))
+    {
+        list |= (object *)room->query_linkdead_players();
+    }
+#endif OWN_STATUE
+#endif STATUE_WHEN_LINKDEAD
+
+    foreach(object player: list - ({ 0 }) )
+    {
+        add_player(player, !interactive(player));
+    }
+}
+
+/*
+ * Function name: notify_presence
+ * Description  : Called from SECURITY whenever a player connects or
+ *                disconnects. See notify() in the master.
+ * Arguments    : object player - the player.
+ *                int type      - the type of event, see CONNECT_* in
+ *                                <const.h>.
+ */
+public void
+notify_presence(object player, int type)
+{
+    if ((previous_object() != find_object(SECURITY)) &&
+        (previous_object() != player))
+    {
+        return;
+    }
+
+    if (!objectp(player) ||
+        !IS_PLAYER_OBJECT(player))
+    {
+        return;
+    }
+
+    updates++;
+    switch(type)
+    {
+    case CONNECT_LOGIN:
+    case CONNECT_REVIVE:
+    case CONNECT_SWITCH:
+        add_player(player, 0);
+        break;
+
+    case CONNECT_LOGOUT:
+        remove_player(player->query_real_name());
+        break;
+
+    case CONNECT_LINKDIE:
+    case CONNECT_REAL_LD:
+        add_player(player, 1);
+        break;
+    }
+}
+
+/*
+ * Function name: update_presence
+ * Description  : Re-evaluates the categories of a player. This is called
+ *                when the wizard rank or the visibility of a player
+ *                changes.
+ * Arguments    : object player - the player to update.
+ */
+public void
+update_presence(object player)
+{
+    string name;
+
+    if (!objectp(player) ||
+        !players[name = player->query_real_name()])
+    {
+        return;
+    }
+
+    updates++;
+    set_categories(name, compute_categories(player,
+        (categories[name] & PRESENCE_LINKDEAD)));
+}
+
+/*
+ * Function name: query_names
+ * Description  : Gives the sorted names of the players in a category.
+ * Arguments    : int category - the category, or 0 for all players.
+ * Returns      : string * - the sorted list of names.
+ */
+public string *
+query_names(int category)
+{
+    validate_presence();
+    queries++;
+
+    if (category == PRESENCE_INVIS)
+    {
+        validate_invis();
+    }
+
+    if (!category)
+    {
+        return names + ({ });
+    }
+
+    return (pointerp(lists[category]) ? (lists[category] + ({ }) ) : ({ }) );
+}
+
+/*
+ * Function name: query_count
+ * Description  : Gives the number of players that are in all of some
+ *                categories and in none of others. The counts are kept up
+ *                to date as players come and go, so no list is built. Mind
+ *                that players that were destructed without logging out are
+ *                counted until the next query_names().
+ * Arguments    : int include - the categories a player must be in.
+ *                int exclude - the categories a player must not be in.
+ * Returns      : int - the number of players.
+ */
+public int
+query_count(int include, int exclude)
+{
+    int total;
+
+    if ((include | exclude) & PRESENCE_INVIS)
+    {
+        validate_invis();
+    }
+
+    foreach(int flags, int count: counts)
+    {
+        if (((flags & include) == include) && !(flags & exclude))
+        {
+            total += count;
+        }
+    }
+
+    return total;
+}
+
+/*
+ * Function name: query_players
+ * Description  : Maps a list of names to the player objects in the game,
+ *                preserving the order of the list. Names that are not in
+ *                the registry are left out.
+ * Arguments    : string *list - the names.
+ * Returns      : object * - the players.
+ */
+public object *
+query_players(string *list)
+{
+    return filter(map(list, &operator([])(players, )), objectp);
+}
+
+/*
+ * Function name: query_categories
+ * Description  : Gives the category flags of a player.
+ * Arguments    : string name - the name of the player.
+ * Returns      : int - the flags, or 0 if the player is not in the game.
+ */
+public int
+query_categories(string name)
+{
+    return categories[name];
+}
+
+/*
+ * Function name: sort_name
+ * Description  : Sort function used by the benchmark to mimic the legacy
+ *                'who' command.
+ */
+public int
+sort_name(object a, object b)
+{
+    string aname = a->query_real_name();
+    string bname = b->query_real_name();
+
+    return ((aname == bname) ? 0 : ((aname < bname) ? -1 : 1));
+}
+
+/*
+ * Function name: cpu_time
+ * Description  : Gives the cpu time used by the game, as /obj/benchmark
+ *                does. gettimeofday() does not change within an evaluation.
+ * Returns      : int - the user and system time in milliseconds.
+ */
+static int
+cpu_time()
+{
+    int *usage = map(explode(SECURITY->do_debug("rusage"), " "), atoi);
+
+    return usage[0] + usage[1];
+}
+
+/*
+ * Function name: benchmark
+ * Description  : Compares the cost of building the mortal view of the
+ *                'who' list by scanning all users, as 'who' used to do,
+ *                with the cost of building it from the registry. Both
+ *                split the players into met and nonmet with the memory of
+ *                this_player(), as 'who' does.
+ * Arguments    : int rounds - the number of times to build the list.
+ * Returns      : string - the report.
+ */
+public string
+benchmark(int rounds)
+{
+    object *list;
+    object *wizards;
+    object *nonmet;
+    object *players;
+    string *result;
+    string *wiznames;
+    string *unknown;
+    mapping memory = ([ ]);
+    mapping rem;
+    string  name = "";
+    int     index;
+    int     cost;
+    int     cpu;
+    int     scan_cost;
+    int     scan_cpu;
+
+    rounds = max(1, rounds);
+    if (objectp(this_player()))
+    {
+        name = this_player()->query_real_name();
+        if (mappingp(rem = this_player()->query_remembered()))
+        {
+            memory += rem;
+        }
+        if (mappingp(rem = this_player()->query_introduced()))
+        {
+            memory += rem;
+        }
+    }
+
+    cpu = cpu_time();
+    cost = EVAL_COST;
+    index = -1;
+    while(++index < rounds)
+    {
+        list = FILTER_LIVING_OBJECTS(users());
+        wizards = filter(list, &->query_wiz_level());
+        list -= filter(wizards, &operator(>=)(, 100) @ &->query_prop(OBJ_I_INVIS));
+        list = filter(list, not @ &wildmatch("*jr", ) @ &->query_real_name());
+        nonmet = filter(list,
+            not @ &operator([])(memory, ) @ &->query_real_name());
+        nonmet = filter(nonmet, not @ &->query_prop(LIVE_I_ALWAYSKNOWN));
+        nonmet -= ({ this_player() });
+        list -= nonmet;
+        nonmet -= wizards;
+        list = sort_array(list, sort_name);
+        nonmet = sort_array(nonmet, sort_name);
+    }
+    scan_cost = EVAL_COST - cost;
+    scan_cpu = cpu_time() - cpu;
+
+    cpu = cpu_time();
+    cost = EVAL_COST;
+    index = -1;
+    while(++index < rounds)
+    {
+        result = query_names(0) - query_names(PRESENCE_LINKDEAD);
+        wiznames = result - query_names(PRESENCE_MORTAL);
+        result -= query_names(PRESENCE_INVIS);
+        result -= query_names(PRESENCE_JUNIOR);
+        unknown = filter(result, not @ &operator([])(memory, ));
+        players = query_players(unknown);
+        unknown -= filter(players, &->query_prop(LIVE_I_ALWAYSKNOWN))->
+            query_real_name();
+        unknown -= ({ name });
+        result -= unknown;
+        unknown -= wiznames;
+        list = query_players(result);
+        nonmet = query_players(unknown);
+    }
+    cost = EVAL_COST - cost;
+    cpu = cpu_time() - cpu;
+
+    return sprintf("Players: %d, rounds: %d\n" +
+        "Scan    : eval %8d, cpu %6d ms\n" +
+        "Registry: eval %8d, cpu %6d ms\n",
+        sizeof(names), rounds, scan_cost, scan_cpu, cost, cpu);
+}
+
+/*
+ * Function name: query_stats
+ * Description  : Gives some statistics about the registry.
+ * Returns      : string - the statistics.
+ */
+public string
+query_stats()
+{
+    validate_presence();
+
+    return sprintf("Players: %d (%d mortal, %d wizard, %d junior, " +
+        "%d invisible, %d linkdead)\nUpdates: %d, queries: %d\n",
+        sizeof(names),
+        sizeof(lists[PRESENCE_MORTAL]), sizeof(lists[PRESENCE_WIZARD]),
+        sizeof(lists[PRESENCE_JUNIOR]), sizeof(lists[PRESENCE_INVIS]),
+        sizeof(lists[PRESENCE_LINKDEAD]), updates, queries);
+}
+
+/*
+ * Function name: query_prevent_shadow
+ * Description  : We do not want anyone shadowing this object.
+ * Returns      : int 1 - always.
+ */
+public nomask int
+query_prevent_shadow()
+{
+    return 1;
+}
@@ -2,6 +2,13 @@
  * /secure/queue.c
  *
  * This object queues people who want to log in when the game is full.
+ *
+ * It also logs out idlers to make room. Rather than checking everybody in
+ * the game at each login attempt, a periodic sweep builds an index of the
+ * players ordered by the time at which they will have been idle too long.
+ * Players who enter the game are added to the index at once. At login, only
+ * the head of that index needs to be examined, and the number of players in
+ * the game is taken from the counts kept by the presence registry.
  */
 
 #pragma no_clone
@@ -15,18 +22,38 @@
 #include <time.h>
 
 /*
- * Prototype.
+ * Prototypes.
  */
 static void inform_queue();
+static void sweep_idlers();
 
 /*
  * The gloval variables.
+ *
+ * idlers - the idle index, ({ ({ (int) deadline, (object) player }) })
+ *          sorted by the time() at which the player exceeds the idle limit.
+ * queued - ([ (object) login : (int) time() entered the queue ])
  */
 private static object *q   = ({ });
 private static string *vip = ({ });
 private static int    alarm_id;
+private static mixed  *idlers = ({ });
+private static mapping queued = ([ ]);
+
+/*
+ * Statistics since the last reboot.
+ */
+private static int admissions;
+private static int admission_cost;
+private static int admission_max_cost;
+private static int evictions;
+private static int sweeps;
+private static int waited;
+private static int wait_total;
+private static int wait_max;
 
 #define QUEUE_TIME              (150.0) /* 2.5 minutes */
+#define IDLE_SWEEP_TIME         ( 60.0) /* 1 minute */
 #define WIZARDS_PER_MORTAL_SLOT (  3  )
 
 /*
@@ -38,6 +65,7 @@ public void
 create()
 {
     alarm_id = set_alarm(QUEUE_TIME, QUEUE_TIME, inform_queue);
+    set_alarm(1.0, IDLE_SWEEP_TIME, sweep_idlers);
 }
 
 /*
@@ -62,6 +90,11 @@ validate_queue()
 {
     q = filter(q, objectp);
     q = filter(q, interactive);
+
+    if (m_sizeof(queued) > sizeof(q))
+    {
+        queued = mkmapping(q, map(q, &operator([])(queued, )));
+    }
 }
 
 /*
@@ -96,21 +129,184 @@ queue_list(int arg)
  *                rooms and they are not involved in slaughtering many NPC
  *                several wizards fit in one mortal players slot. However,
  *                if there is only one wizard in the slot, the slot is still
- *                considered filled.
+ *                considered filled. The connected players are counted by
+ *                the presence registry, so no list of users is made.
  * Returns      : int - the number of slots free for mortal players.
  */
 static int
 slots_free()
+{
+    int mortals;
+    int wizards;
+
+    mortals = PRESENCE_CENTRAL->query_count(PRESENCE_MORTAL,
+        PRESENCE_LINKDEAD);
+    wizards = PRESENCE_CENTRAL->query_count(PRESENCE_WIZARD,
+        PRESENCE_LINKDEAD);
+
+    return (MAX_PLAY - (mortals +
+	((wizards + WIZARDS_PER_MORTAL_SLOT - 1) / WIZARDS_PER_MORTAL_SLOT)));
+}
+
+/*
+ * Function name: idle_limit
+ * Description  : Find out how long a player may idle before being logged
+ *                out to make room for others.
+ * Arguments    : object player - the player.
+ * Returns      : int - the limit in seconds, or 0 if the player may idle.
+ */
+static int
+idle_limit(object player)
+{
+#ifdef NO_WIZARD_IDLE_CHECK
+    if (SECURITY->query_wiz_rank(player->query_real_name()))
+    {
+        return 0;
+    }
+    return MAX_IDLE_TIME;
+#else
+    return (MAX_IDLE_TIME *
+        (1 + SECURITY->query_wiz_rank(player->query_real_name())));
+#endif NO_WIZARD_IDLE_CHECK
+}
+
+/*
+ * Function name: insert_idler
+ * Description  : Adds a player to the idle index, which is kept sorted on
+ *                the deadline. The position is found by binary search.
+ * Arguments    : int deadline - the time() the player exceeds the limit.
+ *                object player - the player.
+ */
+static void
+insert_idler(int deadline, object player)
+{
+    int low = 0;
+    int high = sizeof(idlers);
+    int mid;
+
+    while (low < high)
+    {
+        mid = (low + high) / 2;
+        if (idlers[mid][0] <= deadline)
+        {
+            low = mid + 1;
+        }
+        else
+        {
+            high = mid;
+        }
+    }
+
+    idlers = (low ? idlers[..(low - 1)] : ({ }) ) +
+        ({ ({ deadline, player }) }) + idlers[low..];
+}
+
+/*
+ * Function name: add_idler
+ * Description  : Called by a player who enters the game, to be put in the
+ *                idle index without waiting for the next sweep.
+ * Arguments    : object player - the player.
+ */
+public void
+add_idler(object player)
+{
+    int limit;
+
+    if ((previous_object() != player) ||
+        !interactive(player) ||
+        !(limit = idle_limit(player)))
+    {
+        return;
+    }
+
+    insert_idler((time() - query_idle(player) + limit), player);
+}
+
+/*
+ * Function name: sort_idlers
+ * Description  : Sort function to order the idle index on deadline.
+ */
+public int
+sort_idlers(mixed *a, mixed *b)
+{
+    return (a[0] - b[0]);
+}
+
+/*
+ * Function name: sweep_idlers
+ * Description  : Called regularly to rebuild the idle index. Players who
+ *                are already idle too long are logged out.
+ */
+static void
+sweep_idlers()
 {
     object *list;
-    int    wizards;
+    mixed  *index = ({ });
+    int    limit;
+    int    idle;
+    int    now = time();
 
-    list = users() - ({ previous_object() }) - q;
+    sweeps++;
+    validate_queue();
+    list = users() - q;
     list = filter(list, objectp);
-    wizards = sizeof(filter(list, &->query_wiz_level()));
+    list = filter(list, interactive);
 
-    return (MAX_PLAY - ((sizeof(list) - wizards) +
-	((wizards + WIZARDS_PER_MORTAL_SLOT - 1) / WIZARDS_PER_MORTAL_SLOT)));
+    foreach(object player: list)
+    {
+        if (!(limit = idle_limit(player)))
+        {
+            continue;
+        }
+
+        if ((idle = query_idle(player)) > limit)
+        {
+            set_alarm(0.0, 0.0, &force_quit_idler(player));
+            continue;
+        }
+
+        index += ({ ({ (now - idle + limit), player }) });
+    }
+
+    idlers = sort_array(index, sort_idlers);
+}
+
+/*
+ * Function name: evict_idlers
+ * Description  : Logs out the players at the head of the idle index whose
+ *                deadline has passed. Players who have been active since
+ *                the sweep are put back with their new deadline.
+ */
+static void
+evict_idlers()
+{
+    object player;
+    int    limit;
+    int    idle;
+    int    now = time();
+
+    while (sizeof(idlers) &&
+        (idlers[0][0] < now))
+    {
+        player = idlers[0][1];
+        idlers = idlers[1..];
+
+        if (!objectp(player) ||
+            !interactive(player))
+        {
+            continue;
+        }
+
+        limit = idle_limit(player);
+        if ((idle = query_idle(player)) > limit)
+        {
+            set_alarm(0.0, 0.0, &force_quit_idler(player));
+        }
+        else
+        {
+            insert_idler((now - idle + limit), player);
+        }
+    }
 }
 
 /*
@@ -122,6 +318,12 @@ slots_free()
 public void
 force_quit_idler(object player)
 {
+    if (!objectp(player))
+    {
+        return;
+    }
+
+    evictions++;
     SECURITY->log_syslog("IDLE", sprintf("%s %-11s after %s\n", ctime(time()),
         capitalize(player->query_real_name()), CONVTIME(query_idle(player))));
     tell_object(player,
@@ -142,24 +344,16 @@ force_quit_idler(object player)
 }
 
 /*
- * Function name: should_queue
- * Description  : Call this function to see whether the player should queue.
- *                It does not queue the player yet.
+ * Function name: admit
+ * Description  : Finds out whether the player should queue. This is the
+ *                actual test for should_queue().
  * Arguments    : string name - the name of the player that wants to log in.
  * Returns      : int - true if the player should queue. It returns the
  *                      next queue-number. Else 0.
  */
-public int
-should_queue(string name)
+static int
+admit(string name)
 {
-    object *list;
-
-    /* If not called from the login object, return the queue size. */
-    if (MASTER_OB(previous_object()) != LOGIN_OBJECT)
-    {
-	return sizeof(q) + 1;
-    }
-
     /* Wizards above 'normal' level always enter the game without problems.
      * The same goes for the junior wizhelpers of that rank and above.
      */
@@ -179,26 +373,11 @@ should_queue(string name)
     }
    
     /* Begin by getting rid of idlers. This is done EVERY time anyone
-     * tries to log in. Some can be idle longer than others.
+     * tries to log in. Some can be idle longer than others. Only the
+     * head of the idle index needs to be checked.
      */
     validate_queue();
-    list = users() - ({ previous_object() }) - q;
-    list = filter(list, objectp);
-    list = filter(list, interactive);
-
-    foreach(object player: list)
-    {
-#ifdef NO_WIZARD_IDLE_CHECK
-        if (!SECURITY->query_wiz_rank(player->query_real_name()) &&
-            query_idle(player) > MAX_IDLE_TIME)
-#else
-	if (query_idle(player) > (MAX_IDLE_TIME * (1 +
-	    SECURITY->query_wiz_rank(player->query_real_name()))))
-#endif NO_WIZARD_IDLE_CHECK
-	{
-            set_alarm(0.0, 0.0, &force_quit_idler(player));
-	}
-    }
+    evict_idlers();
 
     /* People are already queueing, so you cannot enter. Take a number. */
     if (sizeof(q))
@@ -216,6 +395,37 @@ should_queue(string name)
     return 0;
 }
 
+/*
+ * Function name: should_queue
+ * Description  : Call this function to see whether the player should queue.
+ *                It does not queue the player yet.
+ * Arguments    : string name - the name of the player that wants to log in.
+ * Returns      : int - true if the player should queue. It returns the
+ *                      next queue-number. Else 0.
+ */
+public int
+should_queue(string name)
+{
+    int cost;
+    int result;
+
+    /* If not called from the login object, return the queue size. */
+    if (MASTER_OB(previous_object()) != LOGIN_OBJECT)
+    {
+	return sizeof(q) + 1;
+    }
+
+    cost = EVAL_COST;
+    result = admit(name);
+    cost = EVAL_COST - cost;
+
+    admissions++;
+    admission_cost += cost;
+    admission_max_cost = max(admission_max_cost, cost);
+
+    return result;
+}
+
 /*
  * Function name: enqueue
  * Description  : Called to see whether a (mortal) player can log in and
@@ -250,6 +460,7 @@ enqueue(object ob)
 
     validate_queue();
     q = q + ({ ob });
+    queued[ob] = time();
 
     if (!alarm_id)
     {
@@ -299,6 +510,13 @@ dequeue(object ob)
 	size = sizeof(q);
 	while(++index < size)
 	{
+            if ((index < free) &&
+                queued[q[index]])
+            {
+                waited++;
+                wait_total += (time() - queued[q[index]]);
+                wait_max = max(wait_max, (time() - queued[q[index]]));
+            }
 	    q[index]->advance((index < free) ? 0 : (index - free + 1));
 	}
 	
@@ -366,6 +584,25 @@ query_position(string name)
     return member_array(name, queue_list(1));
 }
 
+/*
+ * Function name: query_stats
+ * Description  : Gives statistics about the admission of players and the
+ *                eviction of idlers since the last reboot.
+ * Returns      : string - the statistics.
+ */
+public string
+query_stats()
+{
+    return sprintf("Admission checks: %d, eval cost avg %d, max %d\n" +
+        "Admitted from queue: %d, wait avg %s, max %s\n" +
+        "Idle index: %d players, %d sweeps, %d idlers evicted\n",
+        admissions, (admissions ? (admission_cost / admissions) : 0),
+        admission_max_cost, waited,
+        (waited ? CONVTIME(wait_total / waited) : "-"),
+        (wait_max ? CONVTIME(wait_max) : "-"),
+        sizeof(idlers), sweeps, evictions);
+}
+
 /*
  * Function name: set_vip
  * Description  : Give VIP access until the game reboots. The function
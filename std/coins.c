@@ -209,6 +209,44 @@ config_split(int new_num, object orig)
     set_coin_type(orig->query_coin_type());
 }
 
+/*
+ * Function name: enter_env
+ * Description  : After merging with the coins already there, we add the heap
+ *                that remains to the coin ledger of the new environment.
+ * Arguments    : mixed env - the new environment.
+ *                object old - the old environment.
+ */
+public void
+enter_env(mixed env, object old)
+{
+    ::enter_env(env, old);
+
+    if ((environment() == env) &&
+        !query_prop(TEMP_OBJ_ABOUT_TO_DESTRUCT))
+    {
+        env->add_coin_heap(this_object());
+    }
+}
+
+/*
+ * Function name: leave_env
+ * Description  : Remove the heap from the coin ledger of the environment
+ *                before a leftover heap is made, so the leftover can take
+ *                its place.
+ * Arguments    : object env - the environment we are leaving.
+ *                object dest - the destination we are entering (or 0).
+ */
+public void
+leave_env(object env, object dest)
+{
+    if (objectp(env))
+    {
+        env->remove_coin_heap(this_object());
+    }
+
+    ::leave_env(env, dest);
+}
+
 /*
  * Function name: stat_object
  * Description  : When a wizard stats this heap of coins, we add the coin
@@ -21,6 +21,7 @@
 #include <cmdparse.h>
 #include <comb_mag.h>
 #include <composite.h>
+#include <files.h>
 #include <filter_funs.h>
 #include <formulas.h>
 #include <hooks.h>
@@ -904,6 +905,8 @@ cb_hitloc_desc(int hid)
 /*
  * Function name: tell_watcher
  * Description:   Send the string from the fight to people that want them
+ *                Rooms keep track of who watches the fights in them, see
+ *                tell_fight_watchers() in /std/container.c.
  * Arguments:     str   - The string to send
  *                enemy - Who the enemy was
  *                arr   - Array of objects never to send message
@@ -911,23 +914,26 @@ cb_hitloc_desc(int hid)
 varargs void
 tell_watcher(string str, mixed enemy, mixed arr)
 {
+    object env = environment(me);
     object *objs;
 
-    objs = all_inventory(environment(me)) - ({ me });
-    if (arr)
+    if (!pointerp(enemy))
     {
-        if (pointerp(arr))
-            objs -= arr;
-        else
-            objs -= ({ arr });
+        enemy = ({ enemy });
     }
 
-    if (!pointerp(enemy))
+    if (!arr)
+        arr = ({ });
+    else if (!pointerp(arr))
+        arr = ({ arr });
+
+    if (function_exists("tell_fight_watchers", env))
     {
-        enemy = ({ enemy });
+        env->tell_fight_watchers(me, enemy, arr, str, 0);
+        return;
     }
 
-    objs -= enemy;
+    objs = all_inventory(env) - ({ me }) - arr - enemy;
     foreach(object ob: objs)
     {
         if (!ob->query_option(OPT_NO_FIGHTS) && CAN_SEE_IN_ROOM(ob))
@@ -952,17 +958,21 @@ tell_watcher(string str, mixed enemy, mixed arr)
 varargs void
 tell_watcher_miss(string str, object enemy, mixed arr)
 {
+    object env = environment(me);
     object *objs;
 
-    objs = all_inventory(environment(me)) - ({ me, enemy });
-    if (arr)
+    if (!arr)
+        arr = ({ });
+    else if (!pointerp(arr))
+        arr = ({ arr });
+
+    if (function_exists("tell_fight_watchers", env))
     {
-        if (pointerp(arr))
-            objs -= arr;
-        else
-            objs -= ({ arr });
+        env->tell_fight_watchers(me, ({ enemy }), arr, str, 1);
+        return;
     }
 
+    objs = all_inventory(env) - ({ me, enemy }) - arr;
     foreach(object ob: objs)
     {
         if (!ob->query_option(OPT_NO_FIGHTS) &&
@@ -2057,26 +2067,20 @@ heart_beat()
     return;
 }
 
+/*
+ * Function name: log_hit
+ * Description:   Passes a hit or miss on to the combat log. It is written in
+ *                blocks there, so nothing is formatted here.
+ * Arguments:     attacker: The attacker.
+ *                pen, dt, hp, dam: The penetration, damage type, hit points
+ *                           before the hit and damage done.
+ *                location:  The description of the hit location.
+ *                aid:       The attack id.
+ */
 static void
 log_hit(object attacker, int pen, int dt, int hp, int dam, string location, int aid)
 {
-    string message = sprintf("%f %s", gettimeofday(), (dam > 0 ? "HIT" : "MISS"));
-    foreach (mixed value: ({ attacker, me, pen, dt, hp, dam, location, aid })) {
-        if (objectp(value)) {
-            message += "," + file_name(value) + ",\"" +
-                value->query_real_name() + "\"";
-        }
-
-        if (intp(value)) {
-            message += "," + value;
-        }
-
-        if (stringp(value)) {
-            message += ",\"" + value + "\"";
-        }
-    }
-
-    SECURITY->log_syslog("COMBAT_LOG", message + "\n", LOG_SIZE_1M * 10);
+    COMBAT_LOG->add_hit(attacker, me, pen, dt, hp, dam, location, aid);
 }
 
 /*
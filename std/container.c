@@ -11,6 +11,7 @@ inherit "/std/object";
 inherit "/lib/keep";
 
 #include <macros.h>
+#include <options.h>
 #include <stdproperties.h>
 #include <composite.h>
 #include <subloc.h>
@@ -39,6 +40,44 @@ static  mapping   cont_sublocs,    /* Map of sublocations and the object res-
  */
 static mapping container_objects;
 
+/*
+ * cont_watchers = ({ (int)round, (object *)watchers, (object *)gagged,
+ *     ([ (object)fighter : (object *)watchers that see the fighter ]) })
+ *
+ * The people who watch fights in this container. It is kept for one combat
+ * round and reset when something enters or leaves, or when someone changes
+ * the options for watching fights. The deliveries are counted per round.
+ */
+static  mixed     cont_watchers;
+static  int       cont_deliveries,
+                  cont_last_deliveries,
+                  cont_delivery_round;
+
+#define WATCH_ROUND     (5)  /* The length of a combat round in seconds. */
+#define WATCH_TIME      (0)
+#define WATCH_ALL       (1)
+#define WATCH_GAGGED    (2)
+#define WATCH_SEEING    (3)
+
+/*
+ * cont_coins = ([ (string)coin type : (object)heap ])
+ *
+ * The coin heaps in this container, kept current by the coins themselves
+ * when they enter or leave. It saves the money code from searching the
+ * whole inventory with present() for every denomination.
+ */
+static  mapping   cont_coins = ([ ]);
+
+/*
+ * cont_speech_hooks = ([ (object)living : (int) 1 if it defines speech_hook(),
+ *                                           -1 if it does not ])
+ *
+ * The livings in this container that told whether they define
+ * speech_hook(). They register as they move, so speech is not passed to
+ * those who cannot react to it. Livings that did not register, and
+ * livings with a shadow that may define speech_hook(), are always told.
+ */
+static  mapping   cont_speech_hooks = ([ ]);
 
 /*
  * Prototypes
@@ -266,6 +305,8 @@ enter_inv(object ob, object from)
         ob->move(cont_linkroom, 1);
     }
 
+    cont_watchers = 0;
+
     l = ob->query_prop(OBJ_I_LIGHT);
     w = ob->query_prop(OBJ_I_WEIGHT);
     v = ob->query_prop(OBJ_I_VOLUME);
@@ -300,6 +341,8 @@ leave_inv(object ob, object to)
 {
     int l, w, v;
 
+    cont_watchers = 0;
+
     if (cont_linkroom)
         return;
 
@@ -310,6 +353,129 @@ leave_inv(object ob, object to)
     update_internal(-l, -w, -v);
 }
 
+/*
+ * Function name: add_coin_heap
+ * Description:   Called by a heap of coins when it has entered this
+ *                container, to add it to the coin ledger.
+ * Arguments:     ob: The heap of coins.
+ */
+public void
+add_coin_heap(object ob)
+{
+    string type = ob->query_coin_type();
+
+    if (!stringp(type) || (environment(ob) != this_object()))
+        return;
+
+    /* Keep the heap we know, if it is still good. */
+    if (objectp(cont_coins[type]) &&
+        (environment(cont_coins[type]) == this_object()) &&
+        !cont_coins[type]->query_prop(TEMP_OBJ_ABOUT_TO_DESTRUCT))
+        return;
+
+    cont_coins[type] = ob;
+}
+
+/*
+ * Function name: remove_coin_heap
+ * Description:   Called by a heap of coins when it is about to leave this
+ *                container, to remove it from the coin ledger.
+ * Arguments:     ob: The heap of coins.
+ */
+public void
+remove_coin_heap(object ob)
+{
+    string type = ob->query_coin_type();
+
+    if (stringp(type) && (cont_coins[type] == ob))
+        m_delkey(cont_coins, type);
+}
+
+/*
+ * Function name: query_coin_heap
+ * Description:   Finds the heap of coins of a type in this container. The
+ *                ledger is used when it is current, otherwise the inventory
+ *                is searched and the ledger corrected.
+ * Arguments:     type: The coin type, for example "gold".
+ * Returns:       object - the heap of coins, or 0.
+ */
+public object
+query_coin_heap(string type)
+{
+    object ob = cont_coins[type];
+
+    if (objectp(ob) &&
+        (environment(ob) == this_object()) &&
+        !ob->query_prop(TEMP_OBJ_ABOUT_TO_DESTRUCT) &&
+        (ob->query_coin_type() == type))
+        return ob;
+
+    if (objectp(ob = present(type + " coin", this_object())))
+        cont_coins[type] = ob;
+    else
+        m_delkey(cont_coins, type);
+
+    return ob;
+}
+
+/*
+ * Function name: register_speech_hook
+ * Description:   Called by a living when it has entered this container, to
+ *                tell whether it defines speech_hook(). Only the living
+ *                itself may do so.
+ * Arguments:     ob: The living.
+ *                defined: True if it defines speech_hook().
+ */
+public void
+register_speech_hook(object ob, int defined)
+{
+    if (!objectp(ob) ||
+        (previous_object() != ob) ||
+        (environment(ob) != this_object()))
+        return;
+
+    m_delkey(cont_speech_hooks, 0);
+    cont_speech_hooks[ob] = (defined ? 1 : -1);
+}
+
+/*
+ * Function name: unregister_speech_hook
+ * Description:   Called by a living when it is about to leave this
+ *                container. Only the living itself may do so.
+ * Arguments:     ob: The living.
+ */
+public void
+unregister_speech_hook(object ob)
+{
+    if (previous_object() != ob)
+        return;
+
+    m_delkey(cont_speech_hooks, ob);
+}
+
+/*
+ * Function name: filter_speech_hooks
+ * Description:   Finds out which livings in this container should be told
+ *                about speech through speech_hook(). Those that registered
+ *                without it are left out, unless they are shadowed, since a
+ *                shadow may define it.
+ * Arguments:     livings: The livings that hear the speech.
+ * Returns:       object * - the livings to tell.
+ */
+public object *
+filter_speech_hooks(object *livings)
+{
+    object *result = ({ });
+
+    foreach(object ob: livings)
+    {
+        if ((cont_speech_hooks[ob] >= 0) || objectp(shadow(ob, 0)))
+            result += ({ ob });
+    }
+
+    return result;
+}
+
 /*
  * Function name: enter_env
  * Description:   The container enters a new environment
@@ -845,6 +1011,120 @@ show_cont_subloc(string sloc, object for_obj)
     return data;
 }
 
+/*
+ * Function name: reset_fight_watchers
+ * Description:   Forget who is watching fights in this container. Called
+ *                when someone changes the options for watching fights.
+ */
+public void
+reset_fight_watchers()
+{
+    cont_watchers = 0;
+}
+
+/*
+ * Function name: query_fight_watch_cache
+ * Description:   Finds out who is watching fights in this container. This
+ *                is done once per combat round.
+ * Returns:       mixed * - the cache, see cont_watchers.
+ */
+static mixed *
+query_fight_watch_cache()
+{
+    int round = time() / WATCH_ROUND;
+    object *obs;
+
+    if (cont_delivery_round != round)
+    {
+        cont_last_deliveries = ((cont_delivery_round == round - 1) ?
+            cont_deliveries : 0);
+        cont_deliveries = 0;
+        cont_delivery_round = round;
+    }
+
+    if (pointerp(cont_watchers) && (cont_watchers[WATCH_TIME] == round))
+        return cont_watchers;
+
+    obs = ({ });
+    foreach(object ob: all_inventory(this_object()))
+    {
+        if (!ob->query_option(OPT_NO_FIGHTS) &&
+            CAN_SEE_IN_A_ROOM(ob, this_object()))
+        {
+            obs += ({ ob });
+        }
+    }
+
+    cont_watchers = ({ round, obs,
+        filter(obs, &->query_option(OPT_GAG_MISSES)), ([ ]) });
+    return cont_watchers;
+}
+
+/*
+ * Function name: tell_fight_watchers
+ * Description:   Sends a message from a fight to the people in this
+ *                container who want to see it. Those who cannot see the
+ *                attacker are only told that the enemy is hit.
+ * Arguments:     object fighter - the attacker.
+ *                object *enemy  - the enemies, who do not get the message.
+ *                object *exclude - others who do not get the message.
+ *                string str     - the message.
+ *                int miss       - if true, the attack missed.
+ */
+public void
+tell_fight_watchers(object fighter, object *enemy, object *exclude,
+    string str, int miss)
+{
+    mixed *cache = query_fight_watch_cache();
+    object *seeing = cache[WATCH_SEEING][fighter];
+    object *obs;
+
+    if (!pointerp(seeing))
+    {
+        seeing = ({ });
+        foreach(object ob: cache[WATCH_ALL])
+        {
+            if (objectp(ob) && CAN_SEE(ob, fighter))
+                seeing += ({ ob });
+        }
+        cache[WATCH_SEEING][fighter] = seeing;
+    }
+
+    exclude += enemy + ({ fighter, 0 });
+    if (miss)
+    {
+        obs = seeing - cache[WATCH_GAGGED] - exclude;
+        obs->catch_msg(str);
+        cont_deliveries += sizeof(obs);
+        return;
+    }
+
+    obs = seeing - exclude;
+    obs->catch_msg(str);
+    cont_deliveries += sizeof(obs);
+
+    obs = cache[WATCH_ALL] - seeing - exclude;
+    foreach(object ob: obs)
+    {
+        tell_object(ob, capitalize(FO_COMPOSITE_ALL_LIVE(enemy, ob)) +
+            (sizeof(enemy) == 1 ? " is " : " are ") + "hit by someone.\n");
+    }
+    cont_deliveries += sizeof(obs);
+}
+
+/*
+ * Function name: query_fight_deliveries
+ * Description:   Gives the number of fight messages sent to the watchers in
+ *                this container.
+ * Returns:       int * - ({ this round, the previous round })
+ */
+public int *
+query_fight_deliveries()
+{
+    query_fight_watch_cache();
+    return ({ cont_deliveries, cont_last_deliveries });
+}
+
 /*
  * Function name: stat_object
  * Description:   This function is called when a wizard wants to get more
@@ -867,6 +1147,13 @@ stat_object()
         str += "C. Volume: " + tmp + "\n";
     if (tmp = query_prop(CONT_I_MAX_VOLUME))
         str += "C. Max. Volume: " + tmp + "\n";
+    if (cont_delivery_round)
+    {
+        query_fight_watch_cache();
+        str += "Fight watchers: " + sizeof(cont_watchers[WATCH_ALL]) +
+            ", deliveries this round: " + cont_deliveries +
+            ", last round: " + cont_last_deliveries + "\n";
+    }
 
     return str;
 }
@@ -1,38 +1,214 @@
 /*
  * Manages cooldowns in players.
+ *
+ * At runtime every cooldown has an absolute deadline. The deadlines are kept
+ * in a min-heap so that only the earliest one needs to be looked at. A single
+ * alarm is set for the earliest deadline and it is only moved when that
+ * deadline changes.
+ *
+ * The saved cooldowns mapping keeps the old format. Cooldowns that do not
+ * count down while the player is offline are saved with the time remaining,
+ * the others with their absolute expiration time.
  */
 
 mapping cooldowns;
 
 static int cooldown_alarm_id;
-static float last_cooldown_time;
+static float cooldown_alarm_time;
+
+/*
+ * cooldown_expiry - ([ key : ({ deadline, offline, callback }) ])
+ * cooldown_heap   - ({ ({ deadline, key }), ... }) min-heap on deadline.
+ *                   Entries of refreshed or expired cooldowns are skipped
+ *                   when they reach the top.
+ * cooldown_source - the saved mapping the runtime state was built from.
+ */
+static mapping cooldown_expiry;
+static mixed *cooldown_heap = ({ });
+static mapping cooldown_source;
 
 #define COOLDOWN_TIME       (0)
 #define COOLDOWN_CALLBACK   (1)
 #define COOLDOWN_MAX    (86400000.0)  /* The max possible cooldown, if higher
                                        * than this the cooldown is real time. */
 
-static void update_cooldown_state(int mode);
+#define EXPIRY_DEADLINE     (0)
+#define EXPIRY_OFFLINE      (1)
+#define EXPIRY_CALLBACK     (2)
+
+static void expire_cooldowns();
+static void cooldown_alarm();
+
+/*
+ * Function name: cooldown_heap_push
+ * Description  : Adds a deadline to the heap.
+ * Arguments    : float deadline - the absolute expiration time.
+ *                string key - the cooldown.
+ */
+static void
+cooldown_heap_push(float deadline, string key)
+{
+    int index = sizeof(cooldown_heap);
+    int parent;
+    mixed entry = ({ deadline, key });
+
+    cooldown_heap += ({ entry });
+    while (index > 0)
+    {
+        parent = (index - 1) / 2;
+        if (cooldown_heap[parent][0] <= deadline)
+            break;
+
+        cooldown_heap[index] = cooldown_heap[parent];
+        index = parent;
+    }
+    cooldown_heap[index] = entry;
+}
+
+/*
+ * Function name: cooldown_heap_pop
+ * Description  : Removes the earliest deadline from the heap.
+ */
+static void
+cooldown_heap_pop()
+{
+    int size = sizeof(cooldown_heap) - 1;
+    int index = 0;
+    int child;
+    mixed entry;
+
+    if (size <= 0)
+    {
+        cooldown_heap = ({ });
+        return;
+    }
+
+    entry = cooldown_heap[size];
+    cooldown_heap = cooldown_heap[..(size - 1)];
+    while ((child = (2 * index) + 1) < size)
+    {
+        if ((child + 1 < size) &&
+            (cooldown_heap[child + 1][0] < cooldown_heap[child][0]))
+            child++;
+
+        if (entry[0] <= cooldown_heap[child][0])
+            break;
+
+        cooldown_heap[index] = cooldown_heap[child];
+        index = child;
+    }
+    cooldown_heap[index] = entry;
+}
+
+/*
+ * Function name: init_cooldowns
+ * Description  : Builds the runtime deadlines from the saved cooldowns. This
+ *                is done again when the saved mapping was replaced by a
+ *                restore.
+ */
+static void
+init_cooldowns()
+{
+    float now = gettimeofday();
+    float deadline;
+    int offline;
+
+    if (mappingp(cooldown_expiry) && (cooldown_source == cooldowns))
+        return;
+
+    if (!mappingp(cooldowns))
+        cooldowns = ([ ]);
+
+    cooldown_source = cooldowns;
+    cooldown_expiry = ([ ]);
+    cooldown_heap = ({ });
+
+    foreach (string key, mixed cooldown: cooldowns)
+    {
+        if (!pointerp(cooldown))
+            continue;
+
+        offline = (cooldown[COOLDOWN_TIME] > COOLDOWN_MAX);
+        deadline = (offline ? cooldown[COOLDOWN_TIME] :
+            (now + cooldown[COOLDOWN_TIME]));
+        cooldown_expiry[key] = ({ deadline, offline,
+            cooldown[COOLDOWN_CALLBACK] });
+        cooldown_heap_push(deadline, key);
+    }
+
+    expire_cooldowns();
+}
+
+/*
+ * Function name: export_cooldowns
+ * Description  : Writes the runtime deadlines back into the saved format.
+ *                Called before the living is saved.
+ */
+static void
+export_cooldowns()
+{
+    float now = gettimeofday();
+
+    if (!mappingp(cooldown_expiry))
+        return;
+
+    cooldowns = ([ ]);
+    foreach (string key, mixed expiry: cooldown_expiry)
+    {
+        cooldowns[key] = ({ (expiry[EXPIRY_OFFLINE] ?
+            expiry[EXPIRY_DEADLINE] : (expiry[EXPIRY_DEADLINE] - now)),
+            expiry[EXPIRY_CALLBACK] });
+    }
+    cooldown_source = cooldowns;
+}
+
+/*
+ * Function name: schedule_cooldowns
+ * Description  : Makes sure the alarm is set for the earliest deadline. The
+ *                alarm is only moved when that deadline changed.
+ */
+static void
+schedule_cooldowns()
+{
+    if (!sizeof(cooldown_heap))
+    {
+        if (cooldown_alarm_id)
+        {
+            remove_alarm(cooldown_alarm_id);
+            cooldown_alarm_id = 0;
+        }
+        return;
+    }
+
+    if (cooldown_alarm_id &&
+        (cooldown_alarm_time == cooldown_heap[0][0]))
+        return;
+
+    if (cooldown_alarm_id)
+        remove_alarm(cooldown_alarm_id);
+
+    float delay = cooldown_heap[0][0] - gettimeofday();
+
+    cooldown_alarm_time = cooldown_heap[0][0];
+    cooldown_alarm_id = set_alarm(((delay > 0.0) ? delay : 0.0), 0.0,
+        cooldown_alarm);
+}
 
 string
 stat_cooldowns()
 {
-    update_cooldown_state(0);
+    init_cooldowns();
 
-    if (!cooldowns || !m_sizeof(cooldowns))
+    if (!m_sizeof(cooldown_expiry))
         return "";
 
     float current = gettimeofday();
     string str = sprintf("%-30s %s\n", "Cooldown Key", "Remaining (s)");
 
-    foreach (string key, mixed cooldown: cooldowns)
+    foreach (string key, mixed expiry: cooldown_expiry)
     {
-        float left = current - cooldown[COOLDOWN_TIME];
-
-        if (cooldown[COOLDOWN_TIME] < COOLDOWN_MAX) {
-            left = cooldown[COOLDOWN_TIME];
-        }
-        str += sprintf("%-30s %f7.2\n", key, left);
+        str += sprintf("%-30s %7.2f\n", key,
+            expiry[EXPIRY_DEADLINE] - current);
     }
 
     return str + "\n";
@@ -56,32 +232,27 @@ stat_cooldowns()
 int
 trigger_cooldown(string key, float duration, int offline = 0, function expire = 0)
 {
-    if (!mappingp(cooldowns))
-        cooldowns = ([ ]);
+    init_cooldowns();
 
-    /* Update time remaining and check if this is an extension */
-    update_cooldown_state(0);
+    float now = gettimeofday();
+    float deadline = now + duration;
+    mixed expiry = cooldown_expiry[key];
 
-    float now =  gettimeofday();
-    if (cooldowns[key])
+    if (pointerp(expiry) && (expiry[EXPIRY_DEADLINE] > now))
     {
-        float prev = cooldowns[key][COOLDOWN_TIME];
-        float left = prev > COOLDOWN_MAX ? prev - now : prev;
-
         /* Is the current expiration longer? */
-        if (duration < prev) {
-            update_cooldown_state(1);
+        if (deadline < expiry[EXPIRY_DEADLINE])
             return 0;
-        }
 
-        cooldowns[key] = ({ offline ? now + duration : duration, expire });
+        cooldown_expiry[key] = ({ deadline, offline, expire });
         call_hook(HOOK_COOLDOWN_REFRESH, key, duration);
     } else {
-        cooldowns[key] = ({ offline ? now + duration : duration, expire });
+        cooldown_expiry[key] = ({ deadline, offline, expire });
         call_hook(HOOK_COOLDOWN_START, key, duration);
     }
 
-    update_cooldown_state(1);
+    cooldown_heap_push(deadline, key);
+    schedule_cooldowns();
     return 1;
 }
 
@@ -93,71 +264,73 @@ trigger_cooldown(string key, float duration, int offline = 0, function expire =
 int
 query_cooldown(string key)
 {
-    if (!mappingp(cooldowns))
+    mixed expiry;
+
+    init_cooldowns();
+
+    if (!pointerp(expiry = cooldown_expiry[key]))
         return 0;
 
-    update_cooldown_state(0);
-    return pointerp(cooldowns[key]);
+    if (expiry[EXPIRY_DEADLINE] > gettimeofday())
+        return 1;
+
+    expire_cooldowns();
+    return 0;
 }
 
 /*
- * Function name: update_cooldown_state
+ * Function name: expire_cooldowns
  * Description  : Clears any cooldowns which are expired and schedules the
- *                alarm for the next cooldown.
+ *                alarm for the next cooldown. Only the head of the heap is
+ *                examined.
  */
 static void
-update_cooldown_state(int schedule = 1)
+expire_cooldowns()
 {
-    if (!mappingp(cooldowns))
-        return;
-
-    if (schedule && cooldown_alarm_id)
-    {
-        remove_alarm(cooldown_alarm_id);
-        cooldown_alarm_id = 0;
-    }
-
     float now = gettimeofday();
-    float delta = last_cooldown_time ? now - last_cooldown_time : 0.0;
-    float next = 600.0;
+    float deadline;
+    string key;
+    mixed expiry;
+    function callback;
 
-    foreach (string key, mixed cooldown: cooldowns)
+    while (sizeof(cooldown_heap) && (cooldown_heap[0][0] <= now))
     {
-        float expiration = cooldown[COOLDOWN_TIME];
-        float left;
+        deadline = cooldown_heap[0][0];
+        key = cooldown_heap[0][1];
+        cooldown_heap_pop();
 
-        if (expiration > COOLDOWN_MAX)
-        {
-            left = expiration - now;
-        } else  {
-            cooldown[COOLDOWN_TIME] -= delta;
-            left = cooldown[COOLDOWN_TIME];
-        }
+        /* The cooldown was refreshed after this entry was made. */
+        if (!pointerp(expiry = cooldown_expiry[key]) ||
+            (expiry[EXPIRY_DEADLINE] != deadline))
+            continue;
 
-         if (left <= 0.0) {
-            function callback =  cooldown[COOLDOWN_TIME];
-            m_delkey(cooldowns, key);
-            call_hook(HOOK_COOLDOWN_EXPIRED, key);
-
-            if (functionp(callback)) {
-                try {
-                    callback();
-                } catch (string err) {
-                    if (query_wiz_level())
-                        tell_object(this_object(), err);
-                    else
-                       tell_object(this_object(), "You notice a wrongness in " +
-                        "the fabric of space.\n");
-                }
-            }
+        callback = expiry[EXPIRY_CALLBACK];
+        m_delkey(cooldown_expiry, key);
+        call_hook(HOOK_COOLDOWN_EXPIRED, key);
 
-         } else if (left < next) {
-            next = left;
-         }
+        if (functionp(callback)) {
+            try {
+                callback();
+            } catch (string err) {
+                if (query_wiz_level())
+                    tell_object(this_object(), err);
+                else
+                   tell_object(this_object(), "You notice a wrongness in " +
+                    "the fabric of space.\n");
+            }
+        }
     }
 
-    last_cooldown_time = now;
+    schedule_cooldowns();
+}
 
-    if (schedule)
-        cooldown_alarm_id = set_alarm(next, 0.0, &update_cooldown_state());
+/*
+ * Function name: cooldown_alarm
+ * Description  : Called when the alarm for the earliest deadline goes off.
+ */
+static void
+cooldown_alarm()
+{
+    cooldown_alarm_id = 0;
+    expire_cooldowns();
 }
@@ -412,3 +412,41 @@ reveal_me(int tellme)
 
     return 1;
 }
+
+/*
+ * Function name: enter_env
+ * Description  : Tell the new environment whether we define speech_hook(),
+ *                so that it only passes speech on to us if we do.
+ * Arguments    : object dest - the destination we are entering.
+ *                object old  - the location we came from. This can be 0.
+ */
+void
+enter_env(object dest, object old)
+{
+    ::enter_env(dest, old);
+
+    if (objectp(dest))
+    {
+        dest->register_speech_hook(this_object(),
+            !!function_exists("speech_hook", this_object()));
+    }
+}
+
+/*
+ * Function name: leave_env
+ * Description  : Tell the environment we are leaving to forget whether we
+ *                define speech_hook().
+ * Arguments    : object old  - the location we are leaving.
+ *                object dest - the destination we are entering. This can
+ *                              be 0.
+ */
+void
+leave_env(object old, object dest)
+{
+    if (objectp(old))
+    {
+        old->unregister_speech_hook(this_object());
+    }
+
+    ::leave_env(old, dest);
+}
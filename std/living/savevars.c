@@ -1347,6 +1347,10 @@ set_invis(int flag)
     else
         add_prop(OBJ_I_INVIS, flag);
 
+    /* Invisible wizards are hidden from the 'who' list of mortals. */
+    if (query_wiz_level())
+        PRESENCE_CENTRAL->update_presence(this_object());
+
     /* Hook to notify our environment that our visibility changed. */
     environment()->hook_change_invis(this_object());
 }
@@ -8,7 +8,8 @@
  * nomask varargs int * resolve_task(int difficulty, int *skill_list, 
  *     object opponent, int * opp_skill_list)
  *
- * This should be called to determine the success of a given task.
+ * This should be called to determine the success of a given task. The skill
+ * lists may also be task descriptors made with TASK_COMPILE in <tasks.h>.
  */
 
 #include <tasks.h>
@@ -46,12 +47,109 @@ find_listval(mixed member)
 	return this_object()->query_skill(member);
 }
 
+/*
+ * Function: find_kindval
+ * Description: Finds the value of a member of a compiled task, whose kind
+ *              is already known.
+ * Arguments: int kind - the kind of member, TASK_KIND_*.
+ *            mixed key - the skill, stat, property, VBFC or function.
+ * Returns: Value of the member
+ */
+private int
+find_kindval(int kind, mixed key)
+{
+    switch(kind)
+    {
+    case TASK_KIND_SKILL:
+        return this_object()->query_skill(key);
+    case TASK_KIND_STAT:
+        return this_object()->query_stat(key);
+    case TASK_KIND_PROP:
+        return this_object()->query_prop(key);
+    case TASK_KIND_VBFC:
+        return this_object()->check_call(key);
+    case TASK_KIND_FUNCTION:
+        return key();
+    default:
+        return 0;
+    }
+}
+
+/*
+ * Function: find_compiled_drm
+ * Description: Finds the die roll modifiers for this living, given a task
+ *              descriptor made with TASK_COMPILE.
+ * Arguments: mixed *task - the task descriptor.
+ * Returns: a positive integer containing the total die roll modifier (drm)
+ */
+private int
+find_compiled_drm(mixed *task)
+{
+    int mod, weight = 100, drm, tmod, j, size, n = sizeof(task);
+    int i = TASK_FIRST_OP - 1;
+    mixed *op;
+
+    while(++i < n)
+    {
+        if (mod != 0)
+            weight = 100;
+
+        op = task[i];
+        switch(op[0])
+        {
+        case TASK_OP_ONE:
+            mod = find_kindval(op[1], op[2]);
+            break;
+
+        case TASK_OP_MIN:
+        case TASK_OP_MAX:
+            if (!(size = sizeof(op[1])))
+            {
+                mod = 0;
+                break;
+            }
+
+            mod = find_kindval(op[1][0], op[2][0]);
+            for (j = 1; j < size; j++)
+            {
+                tmod = find_kindval(op[1][j], op[2][j]);
+                mod = ((op[0] == TASK_OP_MIN) ? MIN(tmod, mod) : MAX(tmod, mod));
+            }
+            break;
+
+        case TASK_OP_AVG:
+            mod = 0;
+            size = sizeof(op[1]);
+            for (j = 0; j < size; j++)
+            {
+                mod += find_kindval(op[1][j], op[2][j]);
+            }
+            if (size) mod /= size;
+            break;
+
+        case TASK_OP_WEIGHT:
+            weight = op[1];
+            mod = 0;
+            break;
+
+        case TASK_OP_VALUE:
+            mod = op[1];
+            break;
+        }
+
+        drm += weight * mod / 100;
+    }
+
+    return 2 * (task[TASK_CONSTANT] + drm);
+}
+
 /*
  * Function: find_drm
  * Description: Finds the die roll modifiers for a this living, given the
  *              list of applicable skills, stats and modifiers.
  * Arguments: 
- *            'skill_list' is a list of integers or VBFC's, as described above.
+ *            'skill_list' is a list of integers or VBFC's, as described above,
+ *            or a task descriptor made with TASK_COMPILE.
  * Returns: a positive integer containing the total die roll modifier (drm)
  *          (Zero on error)
  */
@@ -60,6 +158,9 @@ find_drm(mixed *skill_list)
 {
     int mod, weight, count, i, drm, n, tmod;
 
+    if (IS_COMPILED_TASK(skill_list))
+        return find_compiled_drm(skill_list);
+
     n = sizeof(skill_list);
     i = 0;
     weight = 100;
@@ -165,6 +266,8 @@ find_drm(mixed *skill_list)
  * Arguments:   'difficulty' is a positive integer, the difficulty of the task
  *              'skill_list' is a list describing the skills and stats to
  *              use in determining success, for the living attempting the task.
+ *              This, and the opponent list, may also be a task descriptor
+ *              made with TASK_COMPILE, which is faster.
  *              'opponent' is the living object which the task works against,
  *              in a competitive task.
  *              'opp_skill_list' describes the skills the opponent uses.
@@ -202,10 +305,16 @@ resolve_task(int difficulty, mixed *skill_list,
 public int
 check_skill(mixed *skilllist, object player)
 {
-    int i, skill;
+    int i, size, skill;
+
+    /* A task descriptor knows the size of the list it was made from. */
+    size = (IS_COMPILED_TASK(skilllist) ? skilllist[TASK_LIST_SIZE] :
+        sizeof(skilllist));
+    if (!size)
+        return 0;
 
     i = player->find_drm(skilllist);
-    skill = (i / sizeof(skilllist));
+    skill = (i / size);
     if (random(100) + 1 <= skill)
 	return 1;
     else
@@ -24,6 +24,8 @@ inherit "/lib/item_expiration";
 #define OBJ_I_SEARCH_ALARM_ID "_obj_i_search_alarm_id"
 
 static string   obj_pshort,     /* Plural short description */
+                obj_short_cache,  /* short() if it has no VBFC */
+                obj_pshort_cache, /* plural_short() if it has no VBFC */
                 obj_subloc,     /* Current sublocation */
                *obj_names,      /* The name(s) of the object */
                *obj_pnames,     /* The plural name(s) of the object */
@@ -50,6 +52,7 @@ private static int hb_alarm_id,    /* Identification of hearbeat callout */
 public  varargs mixed check_call(mixed retval, object for_obj);
         void    add_prop(string prop, mixed val);
 public  void    remove_prop(string prop);
+public  void    reset_short_cache();
 varargs void    add_name(mixed name, int noplural);
 public  mixed   query_prop(string prop);
         mixed   query_adj(int arg);
@@ -427,10 +430,23 @@ short(object for_obj)
             return 0;
     }
 
+    if (stringp(obj_short_cache))
+    {
+        return obj_short_cache;
+    }
+
     string desc = check_call(obj_short, for_obj);
     if (stringp(desc) && query_prop(OBJ_I_BROKEN))
     {
-        return "broken " + desc;
+        desc = "broken " + desc;
+    }
+
+    /* Without VBFC the short is the same for everyone, until the short,
+     * the names, the adjectives or the properties are changed.
+     */
+    if (stringp(obj_short) && !wildmatch("*@@*", obj_short))
+    {
+        obj_short_cache = desc;
     }
 
     return desc;
@@ -497,16 +513,42 @@ plural_short(object for_obj)
     if (!check_seen((objectp(for_obj) ? for_obj : this_player())))
         return 0;
 
+    if (stringp(obj_pshort_cache))
+    {
+        return obj_pshort_cache;
+    }
+
     string pshort = check_call(obj_pshort, for_obj);
 
     if (stringp(pshort) && query_prop(OBJ_I_BROKEN))
     {
-        return "broken " + pshort;
+        pshort = "broken " + pshort;
+    }
+
+    /* See short() for when this is kept. */
+    if (stringp(obj_pshort) && !wildmatch("*@@*", obj_pshort))
+    {
+        obj_pshort_cache = pshort;
     }
 
     return pshort;
 }
 
+/*
+ * Function name: reset_short_cache
+ * Description  : Forgets the short descriptions kept by short() and
+ *                plural_short(). It is called when the short, the names,
+ *                the adjectives or the properties of this object change.
+ *                Objects that change their short in another way should
+ *                call it too.
+ */
+public void
+reset_short_cache()
+{
+    obj_short_cache = 0;
+    obj_pshort_cache = 0;
+}
+
 /*
  * Function name: query_plural_short
  * Description  : This function gives the plural short description of this
@@ -581,6 +623,7 @@ add_prop(string prop, mixed val)
 
     oval = query_prop(prop);
     obj_props[prop] = val;
+    reset_short_cache();
 
     if (environment())
     {
@@ -626,6 +669,7 @@ remove_prop(string prop)
     }
 
     m_delkey(obj_props, prop);
+    reset_short_cache();
 }
 
 #define CFUN
@@ -1098,6 +1142,7 @@ add_list(string *list, mixed elem, int first)
     if (obj_no_change)
         return list;
 
+    reset_short_cache();
     if (pointerp(elem))
         e = elem;
     else
@@ -1129,6 +1174,7 @@ del_list(string *list_old, mixed list_del)
     if (!list_old)
         return list_old;
 
+    reset_short_cache();
     if (!pointerp(list_del))
         list_del = ({ list_del });
 
@@ -1450,7 +1496,10 @@ public void
 set_short(mixed short)
 {
     if (!obj_no_change)
+    {
         obj_short = short;
+        reset_short_cache();
+    }
 }
 
 /*
@@ -1465,7 +1514,10 @@ public void
 set_pshort(mixed pshort)
 {
     if (!obj_no_change)
+    {
         obj_pshort = pshort;
+        reset_short_cache();
+    }
 }
 
 /*
@@ -879,6 +879,13 @@ enter_game(string pl_name, string pwd)
         save_me();
     }
 
+    /* Register with the presence registry. New characters do not pass
+     * through the login notification, so we do it here for all. */
+    PRESENCE_CENTRAL->notify_presence(this_object(), CONNECT_LOGIN);
+
+    /* Idlers may be logged out to make room, see the login queue. */
+    QUEUE->add_idler(this_object());
+
     return 1;
 }
 
@@ -911,6 +918,9 @@ save_player(string pl_name)
         return 0;
     }
 
+    /* Cooldowns are kept as deadlines at runtime. */
+    export_cooldowns();
+
     seteuid(getuid(this_object()));
     save_object(PLAYER_FILE(pl_name));
     seteuid(getuid(this_object()));
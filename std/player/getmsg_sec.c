@@ -15,7 +15,16 @@
 #include <state_desc.h>
 #include <stdproperties.h>
 
+/*
+ * The number of seconds the memo of query_met() is kept.
+ */
+#define MET_CACHE_TIME (60)
+
 static mapping m_introduced_name = ([ ]); /* People who introduced themselves */
+static mapping m_met_cache = ([ ]); /* Memo of query_met(), 1 met, -1 unmet */
+static int     met_cache_time,   /* Time the memo was started */
+               met_cache_hits,   /* Number of answers from the memo */
+               met_cache_misses; /* Number of answers computed */
 static mapping m_gift_today = ([ ]); /* Gifts accepted from people today */
 static mapping m_gmcp = ([ ]); /* Subscribed to GMCP packages. */
 static mapping m_gmcp_options = GMCP_DEFAULT_OPTIONS; /* GMCP options. */
@@ -32,37 +41,52 @@ nomask public void gmcp_team();
  */
 
 /*
- * Function name: query_met
- * Description  : Tells if we know a certain living's name.
- * Arguments    : mixed who: name or object of living.
- * Returns      : int 1/0 - if true, we know the person.
+ * Function name: reset_met_cache
+ * Description  : Forgets what query_met() answered for a name, or for all
+ *                names. Called when someone is introduced to us, when we
+ *                remember or forget someone and when a wizard changes the
+ *                setting to know everyone.
+ * Arguments    : string name - the name, or 0 for all names.
  */
-public int
-query_met(mixed who)
+public void
+reset_met_cache(string name)
 {
-    string name;
-
-#ifndef MET_ACTIVE
-    return 1;
-#else
-    if (objectp(who))
+    if (stringp(name))
     {
-	name = (string)who->query_real_name();
-    }
-    else if (stringp(who))
-    {
-       	name = who;
-	who = find_living(who);
+        m_delkey(m_met_cache, name);
+        return;
     }
-    else
-	return 0;
 
-    if (who->query_prop(LIVE_I_NEVERKNOWN))
-	return 0;
+    m_met_cache = ([ ]);
+    met_cache_time = time();
+}
 
-    if (who->query_prop(LIVE_I_ALWAYSKNOWN))
-	return 1;
+/*
+ * Function name: query_met_cache_stats
+ * Description  : Gives the use of the memo of query_met().
+ * Returns      : string - the report.
+ */
+public string
+query_met_cache_stats()
+{
+    int total = met_cache_hits + met_cache_misses;
 
+    return sprintf("Met memo: %d names, %d hits, %d misses, %d%% hit rate.\n",
+        m_sizeof(m_met_cache), met_cache_hits, met_cache_misses,
+        (total ? ((met_cache_hits * 100) / total) : 0));
+}
+
+/*
+ * Function name: compute_met
+ * Description  : Tells if we know a certain name, apart from the properties
+ *                of the living. See query_met().
+ * Arguments    : object who - the living, if found.
+ *                string name - the name of the living.
+ * Returns      : int 1/0 - if true, we know the person.
+ */
+static int
+compute_met(object who, string name)
+{
     /* Wizards know everyone, unless they don't want to. */
     if (query_wiz_level())
     {
@@ -92,6 +116,68 @@ query_met(mixed who)
 	return 1;
     
     return 0;
+}
+
+/*
+ * Function name: query_met
+ * Description  : Tells if we know a certain living's name. Apart from the
+ *                properties of the living, the answer depends only on the
+ *                name, so it is kept in a memo. The memo is started over
+ *                every MET_CACHE_TIME seconds to notice changes in the rank
+ *                of a wizard.
+ * Arguments    : mixed who: name or object of living.
+ * Returns      : int 1/0 - if true, we know the person.
+ */
+public int
+query_met(mixed who)
+{
+    string name;
+    int    met;
+
+#ifndef MET_ACTIVE
+    return 1;
+#else
+    if (objectp(who))
+    {
+	name = (string)who->query_real_name();
+    }
+    else if (stringp(who))
+    {
+       	name = who;
+	who = find_living(who);
+    }
+    else
+	return 0;
+
+    if (who->query_prop(LIVE_I_NEVERKNOWN))
+	return 0;
+
+    if (who->query_prop(LIVE_I_ALWAYSKNOWN))
+	return 1;
+
+    if (met_cache_time + MET_CACHE_TIME < time())
+    {
+        reset_met_cache(0);
+    }
+
+    if (met = m_met_cache[name])
+    {
+        met_cache_hits++;
+        return (met > 0);
+    }
+    met_cache_misses++;
+
+    met = compute_met(who, name);
+
+    /* Players and NPC's may have the same name, so don't keep the answer
+     * when it depends on whether the living is an NPC.
+     */
+    if (stringp(name) &&
+        ((query_wiz_unmet() != 2) || !query_wiz_level()))
+    {
+        m_met_cache[name] = (met ? 1 : -1);
+    }
+    return met;
 #endif MET_ACTIVE
 }
 
@@ -107,6 +193,7 @@ add_introduced(string str)
         return;  /* Don't add if already present */
 
     m_introduced_name[str] = 1;
+    reset_met_cache(str);
 }
 
 /*
@@ -121,6 +208,7 @@ remove_introduced(string str)
         return 0;
 
     m_delkey(m_introduced_name, str);
+    reset_met_cache(str);
     return 1;
 }
 
@@ -83,6 +83,7 @@ nomask public int query_skill_decay();
 #endif NO_SKILL_DECAY
 public varargs mixed query_introduced(mixed name);
 public int remove_introduced(string str);
+public void reset_met_cache(string name);
 nomask public void gmcp_char(string package, string name, mixed value);
 
 /*
@@ -1232,6 +1233,11 @@ query_nicks()
 public nomask int
 set_option(int opt, int val)
 {
+    /* The room keeps track of who watches the fights in it. */
+    if (((opt == OPT_NO_FIGHTS) || (opt == OPT_GAG_MISSES)) &&
+        objectp(environment()))
+        environment()->reset_fight_watchers();
+
     switch (opt)
     {
     case OPT_MORE_LEN:
@@ -1463,6 +1469,7 @@ public nomask void
 set_remember_name(mapping nlist)
 {
     m_remember_name = ([ ]) + nlist;
+    reset_met_cache(0);
 }
 
 /*
@@ -1567,6 +1574,7 @@ add_remembered(string str)
 
     remove_introduced(str);
     m_remember_name[str] = 1;
+    reset_met_cache(str);
 
     return 1; /* Remember ok */
 }
@@ -1594,6 +1602,7 @@ remove_remembered(string name)
     {
         result = 1;
         m_delkey(m_remember_name, name);
+        reset_met_cache(name);
     }
 
     return result;
@@ -1777,6 +1786,7 @@ public int
 set_wiz_unmet(int flag)
 {
     wiz_unmet = flag;
+    reset_met_cache(0);
     return wiz_unmet;
 }
 
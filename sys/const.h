@@ -70,6 +70,37 @@
 #define CONNECT_SWITCH  (4)
 #define CONNECT_REAL_LD (5)
 
+/*
+ * Categories of players kept by the presence registry, PRESENCE_CENTRAL.
+ *
+ * PRESENCE_MORTAL   - mortal player (no wizard rank).
+ * PRESENCE_WIZARD   - player with a wizard rank.
+ * PRESENCE_JUNIOR   - junior character (name ending in "jr").
+ * PRESENCE_INVIS    - wizard who is invisible (OBJ_I_INVIS >= 100).
+ * PRESENCE_LINKDEAD - player who is in the game without a connection.
+ */
+#define PRESENCE_MORTAL   (1)
+#define PRESENCE_WIZARD   (2)
+#define PRESENCE_JUNIOR   (4)
+#define PRESENCE_INVIS    (8)
+#define PRESENCE_LINKDEAD (16)
+#define PRESENCE_CATEGORIES ({ PRESENCE_MORTAL, PRESENCE_WIZARD, \
+    PRESENCE_JUNIOR, PRESENCE_INVIS, PRESENCE_LINKDEAD })
+
+/*
+ * Stages of the login that are rate limited by LOGIN_PIPELINE.
+ *
+ * LOGIN_STAGE_RESTORE     - reading the player file in the login object.
+ * LOGIN_STAGE_PASSWORD    - checking the password.
+ * LOGIN_STAGE_MATERIALIZE - cloning and restoring the body, auto-loading.
+ */
+#define LOGIN_STAGE_RESTORE     (0)
+#define LOGIN_STAGE_PASSWORD    (1)
+#define LOGIN_STAGE_MATERIALIZE (2)
+#define LOGIN_STAGES ({ LOGIN_STAGE_RESTORE, LOGIN_STAGE_PASSWORD, \
+    LOGIN_STAGE_MATERIALIZE })
+#define LOGIN_STAGE_NAMES ({ "restore", "password", "materialize" })
+
 /*
  * Some default light values for various types of items in the game. 
  * 
@@ -70,17 +70,21 @@
 
 #define APPLICATION_PLAYER ("/secure/application_player")
 #define BOARD_CENTRAL      ("/secure/mbs_central")
+#define COMBAT_LOG         ("/secure/combat_log")
 #define DOCMAKER           ("/secure/docmake")
 #define EDITOR_SECURITY    ("/secure/editor")
+#define FILE_INDEX         ("/secure/file_index")
 #define FINGER_PLAYER      ("/secure/finger_player")
 #define GAMEINFO_OBJECT    ("/secure/gameinfo_player")
 #define GOG_ACCOUNTS       ("/secure/gog_accounts")
 #define LOGIN_OBJECT       ("/secure/login")
+#define LOGIN_PIPELINE     ("/secure/login_pipeline")
 #define MAIL_CHECKER       ("/secure/mail_checker")
 #define MAIL_READER        ("/secure/mail_reader")
 #define MAP_CENTRAL        ("/secure/map_central")
 #define MSSP               ("/secure/mssp")
 #define PLAYER_TOOL        ("/secure/player_tool")
+#define PRESENCE_CENTRAL   ("/secure/presence")
 #define PURGE_OBJECT       ("/secure/purge")
 #define QUEUE              ("/secure/queue")
 #define REPORT_CENTRAL     ("/secure/report_central")
@@ -140,8 +144,10 @@
 
 /* The section /sys */
 #define MANCTRL            ("/sys/global/manpath")
+#define DOC_INDEX          ("/sys/global/docindex")
 #define FPATH_FILENAME     ("/sys/global/filepath")
 #define LISTENER_CENTRAL   ("/sys/global/listeners")
+#define HOOK_PROFILER      ("/sys/global/hook_profiler")
 #define ACHIEVEMENTS       ("/d/Genesis/specials/achievements/achievement_master")
 #define WEBSTATS_CENTRAL   ("/d/Web/stats/webstats")
 #define MAGIC_MAP_ID       ("_sparkle_magic_map")
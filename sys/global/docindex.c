@@ -0,0 +1,580 @@
+/*
+ * /sys/global/docindex.c
+ *
+ * The document index. It keeps, for a set of directories, the files in
+ * them with their first lines, and an inverted index of the words in the
+ * files. It answers keyword searches ranked on relevance and it gives file
+ * lists and titles without reading the disk every time.
+ *
+ * The manual pages in /doc/man and /doc/sman and the help in /doc/help are
+ * indexed with all directories below them. Other directories, like the
+ * help directories of /lib/help and the shelves of /lib/library, are added
+ * when they are first asked for.
+ *
+ * The index is built in small steps. The master tells us about every write
+ * through note_write(), and a directory that was written to is listed again
+ * when it is next asked for. Every REFRESH_TIME seconds all directories are
+ * listed as well. Only files with a new file time are read.
+ */
+
+#pragma no_clone
+#pragma no_inherit
+#pragma save_binary
+#pragma strict_types
+
+#include <macros.h>
+#include <std.h>
+
+#define INDEX_TREES    ({ "/doc/man", "/doc/sman", "/doc/help" })
+#define HEADER_LINES   (4)       /* The number of lines kept per file. */
+#define MIN_WORD       (3)       /* Shorter words are not indexed. */
+#define MAX_FILE       (100000)  /* Larger files are not indexed. */
+#define STEP_DELAY     (1.0)
+#define STEP_EVAL      (100000)
+#define REFRESH_TIME   (600)
+#define MAX_RESULTS    (50)
+
+#define DIR_CHANGED    (0)
+#define DIR_FILES      (1)
+
+#define FILE_TIME      (0)
+#define FILE_HEADER    (1)
+
+#define SEPARATORS     ({ "\n", "\t", ".", ",", ";", ":", "(", ")", "[", \
+                          "]", "{", "}", "<", ">", "\"", "'", "`", "!", \
+                          "?", "=", "+", "*", "/", "\\", "|", "&", "%", \
+                          "#", "@", "$", "~", "^", "-" })
+#define STOP_WORDS     ({ "the", "and", "for", "you", "are", "this", "that", \
+                          "with", "not", "can", "will", "have", "all", \
+                          "from", "but", "has", "its", "was", "then" })
+
+/*
+ * Global variables. They are not saved.
+ *
+ * dirs      - ([ (string) dir : ({ (int) changed, ([ (string) name :
+ *                 ({ (int) time, (string *) first lines }) ]) }) ])
+ *             changed is true when the directory was written to since it
+ *             was listed.
+ * doc_words - ([ (string) file : (string *) words ])
+ * postings  - ([ (string) word : ([ (string) file : (int) count ]) ])
+ * trees     - directories that are indexed with all directories below.
+ * dir_queue - directories to be listed.
+ * doc_queue - files to be read.
+ * queries   - ({ (int) count, (int) total eval, (int) max eval })
+ */
+private static mapping dirs      = ([ ]);
+private static mapping doc_words = ([ ]);
+private static mapping postings  = ([ ]);
+private static string *trees     = INDEX_TREES;
+private static string *dir_queue = INDEX_TREES;
+private static string *doc_queue = ({ });
+private static int    *queries   = ({ 0, 0, 0 });
+private static int     step_alarm;
+
+/*
+ * Prototypes.
+ */
+static void step();
+static void refresh();
+
+/*
+ * Function name: create
+ * Description  : Constructor. Starts building the index.
+ */
+public void
+create()
+{
+    setuid();
+    seteuid(getuid());
+
+    step_alarm = set_alarm(STEP_DELAY, 0.0, step);
+    set_alarm(itof(REFRESH_TIME), itof(REFRESH_TIME), refresh);
+}
+
+/*
+ * Function name: schedule
+ * Description  : Makes sure the next step of building the index is set.
+ */
+static void
+schedule()
+{
+    if (!step_alarm)
+    {
+        step_alarm = set_alarm(STEP_DELAY, 0.0, step);
+    }
+}
+
+/*
+ * Function name: tokenize
+ * Description  : Splits a text into the words that are indexed.
+ * Arguments    : string text - the text.
+ * Returns      : mapping - ([ (string) word : (int) count ])
+ */
+static mapping
+tokenize(string text)
+{
+    mapping words = ([ ]);
+
+    text = lower_case(text);
+    foreach(string separator: SEPARATORS)
+    {
+        text = implode(explode(text, separator), " ");
+    }
+
+    foreach(string word: explode(text, " "))
+    {
+        if (strlen(word) >= MIN_WORD)
+        {
+            words[word]++;
+        }
+    }
+
+    foreach(string word: STOP_WORDS)
+    {
+        m_delkey(words, word);
+    }
+
+    return words;
+}
+
+/*
+ * Function name: forget_doc
+ * Description  : Removes a file from the inverted index.
+ * Arguments    : string file - the file.
+ */
+static void
+forget_doc(string file)
+{
+    if (!pointerp(doc_words[file]))
+    {
+        return;
+    }
+
+    foreach(string word: doc_words[file])
+    {
+        if (mappingp(postings[word]))
+        {
+            m_delkey(postings[word], file);
+            if (!m_sizeof(postings[word]))
+            {
+                m_delkey(postings, word);
+            }
+        }
+    }
+
+    m_delkey(doc_words, file);
+}
+
+/*
+ * Function name: index_doc
+ * Description  : Reads a file and adds it to the index.
+ * Arguments    : string file - the file.
+ */
+static void
+index_doc(string file)
+{
+    string *parts = explode(file, "/");
+    string  dir = implode(parts[..(sizeof(parts) - 2)], "/");
+    string  name = parts[sizeof(parts) - 1];
+    string  text;
+    mapping words;
+
+    forget_doc(file);
+    if (!pointerp(dirs[dir]) || !pointerp(dirs[dir][DIR_FILES][name]))
+    {
+        return;
+    }
+
+    if ((file_size(file) > MAX_FILE) || !strlen(text = read_file(file)))
+    {
+        dirs[dir][DIR_FILES][name][FILE_HEADER] = ({ });
+        return;
+    }
+
+    dirs[dir][DIR_FILES][name][FILE_HEADER] =
+        explode(text, "\n")[..(HEADER_LINES - 1)];
+
+    words = tokenize(name + " " + text);
+    foreach(string word, int count: words)
+    {
+        if (!mappingp(postings[word]))
+        {
+            postings[word] = ([ ]);
+        }
+        postings[word][file] = count;
+    }
+    doc_words[file] = m_indices(words);
+}
+
+/*
+ * Function name: list_dir
+ * Description  : Lists a directory. Files that are new or have a new file
+ *                time are queued to be read, files that are gone are
+ *                removed. In the indexed trees new directories are queued.
+ * Arguments    : string dir - the directory, without trailing slash.
+ */
+static void
+list_dir(string dir)
+{
+    mapping old = (pointerp(dirs[dir]) ? dirs[dir][DIR_FILES] : ([ ]));
+    mapping files = ([ ]);
+    string  path;
+    int     in_tree;
+    int     when;
+
+    if (file_size(dir) != -2)
+    {
+        foreach(string name, mixed *data: old)
+        {
+            forget_doc(dir + "/" + name);
+        }
+        m_delkey(dirs, dir);
+        return;
+    }
+
+    foreach(string tree: trees)
+    {
+        in_tree = in_tree || (dir == tree) || wildmatch(tree + "/*", dir);
+    }
+
+    foreach(string name: get_dir(dir + "/") - ({ ".", ".." }))
+    {
+        path = dir + "/" + name;
+        if (file_size(path) == -2)
+        {
+            if (in_tree && !pointerp(dirs[path]))
+            {
+                dir_queue += ({ path });
+            }
+            continue;
+        }
+
+        when = file_time(path);
+        if (pointerp(old[name]) && (old[name][FILE_TIME] == when))
+        {
+            files[name] = old[name];
+            continue;
+        }
+
+        files[name] = ({ when, 0 });
+        doc_queue += ({ path });
+    }
+
+    foreach(string name: m_indices(old) - m_indices(files))
+    {
+        forget_doc(dir + "/" + name);
+    }
+
+    dirs[dir] = ({ 0, files });
+}
+
+/*
+ * Function name: step
+ * Description  : One step of building the index, limited in eval cost.
+ */
+static void
+step()
+{
+    int cost = EVAL_COST;
+    string path;
+
+    step_alarm = 0;
+
+    while (EVAL_COST - cost < STEP_EVAL)
+    {
+        if (sizeof(doc_queue))
+        {
+            path = doc_queue[0];
+            doc_queue = doc_queue[1..];
+            index_doc(path);
+            continue;
+        }
+
+        if (!sizeof(dir_queue))
+        {
+            break;
+        }
+
+        path = dir_queue[0];
+        dir_queue = dir_queue[1..];
+        list_dir(path);
+    }
+
+    if (sizeof(doc_queue) || sizeof(dir_queue))
+    {
+        schedule();
+    }
+}
+
+/*
+ * Function name: refresh
+ * Description  : Called every REFRESH_TIME seconds to list all directories
+ *                again, so that changed files are read again.
+ */
+static void
+refresh()
+{
+    dir_queue |= m_indices(dirs);
+    schedule();
+}
+
+/*
+ * Function name: clean_dir
+ * Description  : Gives a directory without trailing slash.
+ * Arguments    : string dir - the directory.
+ * Returns      : string - the directory.
+ */
+static string
+clean_dir(string dir)
+{
+    while (strlen(dir) > 1 && (dir[-1..] == "/"))
+    {
+        dir = dir[..-2];
+    }
+
+    return dir;
+}
+
+/*
+ * Function name: known_dir
+ * Description  : Makes sure a directory is in the index and up to date. A
+ *                directory that is not known yet, or that was written to,
+ *                is listed now. Its files are read later.
+ * Arguments    : string dir - the directory, without trailing slash.
+ * Returns      : int 1/0 - true if the directory exists.
+ */
+static int
+known_dir(string dir)
+{
+    if (!pointerp(dirs[dir]) || dirs[dir][DIR_CHANGED])
+    {
+        list_dir(dir);
+        schedule();
+    }
+
+    return pointerp(dirs[dir]);
+}
+
+/*
+ * Function name: query_files
+ * Description  : Gives the names of the files in a directory.
+ * Arguments    : string dir - the directory.
+ *                string pattern - if given, only names that match it.
+ * Returns      : string * - the names, sorted.
+ */
+public string *
+query_files(string dir, string pattern = 0)
+{
+    string *names;
+
+    dir = clean_dir(dir);
+    if (!SECURITY->valid_read(dir, previous_object(), "get_dir") ||
+        !known_dir(dir))
+    {
+        return ({ });
+    }
+
+    names = m_indices(dirs[dir][DIR_FILES]);
+    if (stringp(pattern))
+    {
+        names = filter(names, &wildmatch(pattern, ));
+    }
+
+    return sort_array(names);
+}
+
+/*
+ * Function name: query_header
+ * Description  : Gives the first lines of a file. When the file was not
+ *                read yet, the lines are read from disk now.
+ * Arguments    : string file - the file.
+ * Returns      : string * - the first HEADER_LINES lines.
+ */
+public string *
+query_header(string file)
+{
+    string *parts = explode(file, "/");
+    string  dir = implode(parts[..(sizeof(parts) - 2)], "/");
+    string  name = parts[sizeof(parts) - 1];
+    mixed  *data;
+    string  text;
+
+    if (!SECURITY->valid_read(file, previous_object(), "read_file") ||
+        !known_dir(dir) || !pointerp(data = dirs[dir][DIR_FILES][name]))
+    {
+        return ({ });
+    }
+
+    if (!pointerp(data[FILE_HEADER]))
+    {
+        text = read_file(file, 1, HEADER_LINES);
+        data[FILE_HEADER] = (strlen(text) ? explode(text, "\n") : ({ }));
+    }
+
+    return data[FILE_HEADER] + ({ });
+}
+
+/*
+ * Function name: sort_score
+ * Description  : Sorts files on their score, highest first.
+ */
+static int
+sort_score(mapping score, string a, string b)
+{
+    return score[b] - score[a];
+}
+
+/*
+ * Function name: query_search
+ * Description  : Searches the indexed files for words. A file scores higher
+ *                when it has the words more often, when the words are rare
+ *                and when its name is one of the words. When no file has all
+ *                words, the files that have some of them are given.
+ * Arguments    : string text - the words to search for.
+ *                string prefix - if given, only files below this directory.
+ * Returns      : string * - the files, best first, at most MAX_RESULTS.
+ */
+public string *
+query_search(string text, string prefix = 0)
+{
+    int      cost = EVAL_COST;
+    string  *words = m_indices(tokenize(text));
+    mapping  score = ([ ]);
+    mapping  found = ([ ]);
+    mapping  files;
+    string  *result;
+    string  *parts;
+    int      weight;
+
+    foreach(string word: words)
+    {
+        if (!mappingp(files = postings[word]))
+        {
+            continue;
+        }
+
+        weight = 1000 / m_sizeof(files);
+        foreach(string file, int count: files)
+        {
+            if (stringp(prefix) && !wildmatch(prefix + "*", file))
+            {
+                continue;
+            }
+
+            parts = explode(file, "/");
+            score[file] += (count * max(weight, 1)) +
+                ((parts[sizeof(parts) - 1] == word) ? 100000 : 0);
+            found[file]++;
+        }
+    }
+
+    result = filter(m_indices(found), &operator(==)(sizeof(words)) @
+        &operator([])(found, ));
+    if (!sizeof(result))
+    {
+        result = m_indices(found);
+    }
+
+    result = filter(sort_array(result, &sort_score(score)),
+        &SECURITY->valid_read(, previous_object(), "read_file"));
+    result = result[..(MAX_RESULTS - 1)];
+
+    cost = EVAL_COST - cost;
+    queries[0]++;
+    queries[1] += cost;
+    queries[2] = max(queries[2], cost);
+    return result;
+}
+
+/*
+ * Function name: note_write
+ * Description  : Called by the master when it allows a write. The directory
+ *                of the file, and the file itself if it is a directory, are
+ *                listed again when they are asked for.
+ * Arguments    : string file - the file written to.
+ */
+public void
+note_write(string file)
+{
+    string *parts;
+
+    if (previous_object() != find_object(SECURITY))
+    {
+        return;
+    }
+
+    parts = explode(file, "/") - ({ "" });
+    file = "/" + implode(parts, "/");
+    if (pointerp(dirs[file]))
+    {
+        dirs[file][DIR_CHANGED] = 1;
+    }
+
+    file = ((sizeof(parts) > 1) ?
+        ("/" + implode(parts[..(sizeof(parts) - 2)], "/")) : "/");
+    if (pointerp(dirs[file]))
+    {
+        dirs[file][DIR_CHANGED] = 1;
+    }
+}
+
+/*
+ * Function name: add_tree
+ * Description  : Adds a directory and all directories below it to the index.
+ *                Only the master and archwizards may do so, as the whole
+ *                tree is kept in memory.
+ * Arguments    : string dir - the directory.
+ */
+public void
+add_tree(string dir)
+{
+    if ((previous_object() != find_object(SECURITY)) &&
+        (!objectp(this_interactive()) ||
+         (SECURITY->query_wiz_rank(this_interactive()->query_real_name()) <
+          WIZ_ARCH)))
+    {
+        return;
+    }
+
+    dir = clean_dir(dir);
+    if (member_array(dir, trees) == -1)
+    {
+        trees += ({ dir });
+        dir_queue += ({ dir });
+        schedule();
+    }
+}
+
+/*
+ * Function name: query_status
+ * Description  : Gives the size of the index and the cost of the searches.
+ * Returns      : string - the report.
+ */
+public string
+query_status()
+{
+    int count;
+
+    foreach(string word, mapping files: postings)
+    {
+        count += m_sizeof(files);
+    }
+
+    return sprintf("Document index: %d directories, %d files, %d words, " +
+        "%d postings.\nWaiting: %d directories and %d files.\n" +
+        "Searches: %d, average eval %d, maximum eval %d.\n",
+        m_sizeof(dirs), m_sizeof(doc_words), m_sizeof(postings), count,
+        sizeof(dir_queue), sizeof(doc_queue), queries[0],
+        (queries[0] ? (queries[1] / queries[0]) : 0), queries[2]);
+}
+
+/*
+ * Function name: query_prevent_shadow
+ * Description  : We do not want anyone shadowing this object.
+ * Returns      : int 1 - always.
+ */
+public nomask int
+query_prevent_shadow()
+{
+    return 1;
+}
@@ -0,0 +1,215 @@
+/*
+ * /sys/global/hook_profiler.c
+ *
+ * This object collects statistics on the hooks called through call_hook()
+ * in /lib/hooks.c. Profiling is off by default. When it is switched on,
+ * every callback that is called records its hook name, the program that
+ * defines the callback, the evaluation cost and whether it failed. The time
+ * is not recorded, as gettimeofday() does not change during an evaluation.
+ * Objects with hooks ask whether profiling is on only every few seconds,
+ * so switching it on takes effect within that time. Use the wizard command
+ * 'hookstat' to see the results.
+ */
+
+#pragma no_clone
+#pragma no_inherit
+#pragma save_binary
+#pragma strict_types
+
+#include <macros.h>
+#include <std.h>
+#include <time.h>
+
+#define STAT_CALLS  (0)
+#define STAT_COST   (1)
+#define STAT_ERRORS (2)
+
+/*
+ * Global variables. They are not saved.
+ *
+ * stats   - ([ (string) hook : ([ (string) program :
+ *               ({ (int) calls, (int) cost, (int) errors }) ]) ])
+ * active  - true if profiling is on.
+ * started - the time profiling was switched on.
+ */
+private static mapping stats = ([ ]);
+private static int     active;
+private static int     started;
+
+/*
+ * Function name: create
+ * Description  : Constructor.
+ */
+public void
+create()
+{
+    setuid();
+    seteuid(getuid());
+}
+
+/*
+ * Function name: valid_user
+ * Description  : Only full wizards may switch profiling on or off.
+ * Returns      : int 1/0 - true if allowed.
+ */
+static int
+valid_user()
+{
+    return (SECURITY->query_wiz_rank(this_interactive()->query_real_name())
+        >= WIZ_NORMAL);
+}
+
+/*
+ * Function name: set_active
+ * Description  : Switches profiling on or off.
+ * Arguments    : int on - true to switch it on.
+ * Returns      : int 1/0 - success/failure.
+ */
+public int
+set_active(int on)
+{
+    if (!valid_user())
+    {
+        return 0;
+    }
+
+    if (on && !active)
+    {
+        started = time();
+    }
+    active = on;
+    return 1;
+}
+
+/*
+ * Function name: query_active
+ * Description  : Called from call_hook() to see whether to profile.
+ * Returns      : int 1/0 - true if profiling is on.
+ */
+public int
+query_active()
+{
+    return active;
+}
+
+/*
+ * Function name: clear
+ * Description  : Forgets all statistics.
+ * Returns      : int 1/0 - success/failure.
+ */
+public int
+clear()
+{
+    if (!valid_user())
+    {
+        return 0;
+    }
+
+    stats = ([ ]);
+    started = time();
+    return 1;
+}
+
+/*
+ * Function name: record_hook
+ * Description  : Records one callback of a hook. Only call_hook() in
+ *                /lib/hooks.c may call this.
+ * Arguments    : string hook - the name of the hook.
+ *                string program - the program of the callback.
+ *                int cost - the evaluation cost.
+ *                int error - true if the callback failed.
+ */
+public void
+record_hook(string hook, string program, int cost, int error)
+{
+    int *stat;
+
+    if (!active || (calling_program() != "lib/hooks.c"))
+    {
+        return;
+    }
+
+    if (!mappingp(stats[hook]))
+    {
+        stats[hook] = ([ ]);
+    }
+
+    if (!pointerp(stat = stats[hook][program]))
+    {
+        stat = stats[hook][program] = ({ 0, 0, 0 });
+    }
+
+    stat[STAT_CALLS]++;
+    stat[STAT_COST] += cost;
+    stat[STAT_ERRORS] += error;
+}
+
+/*
+ * Function name: sort_rows
+ * Description  : Sorts the rows of the report on one column, highest first.
+ */
+static int
+sort_rows(int column, mixed *a, mixed *b)
+{
+    return ((a[column] == b[column]) ? 0 : ((a[column] > b[column]) ? -1 : 1));
+}
+
+/*
+ * Function name: query_top
+ * Description  : Gives the hooks and callback programs that cost the most.
+ * Arguments    : int count - the number of lines to give, 0 for all.
+ *                string order - sort on "calls", "cost" or "errors".
+ * Returns      : string - the report.
+ */
+public string
+query_top(int count, string order = "cost")
+{
+    mixed *rows = ({ });
+    string text;
+    int    column;
+
+    foreach(string hook, mapping programs: stats)
+    {
+        foreach(string program, mixed *stat: programs)
+        {
+            rows += ({ ({ hook, program }) + stat });
+        }
+    }
+
+    if (!sizeof(rows))
+    {
+        return "No hooks were profiled" +
+            (active ? " yet" : ", profiling is off") + ".\n";
+    }
+
+    column = member_array(order, ({ "calls", "cost", "errors" }));
+    column = ((column == -1) ? STAT_COST : column) + 2;
+    rows = sort_array(rows, &sort_rows(column));
+    if (count > 0)
+    {
+        rows = rows[..(count - 1)];
+    }
+
+    text = sprintf("Profiling %s, %s.\n%-30s %-30s %7s %10s %4s\n",
+        (active ? "on" : "off"), CONVTIME(time() - started), "Hook",
+        "Program", "Calls", "Cost", "Err");
+    foreach(mixed *row: rows)
+    {
+        text += sprintf("%-30s %-30s %7d %10d %4d\n", row[0],
+            ((strlen(row[1]) > 30) ? row[1][-30..] : row[1]),
+            row[STAT_CALLS + 2], row[STAT_COST + 2], row[STAT_ERRORS + 2]);
+    }
+
+    return text;
+}
+
+/*
+ * Function name: query_prevent_shadow
+ * Description  : We do not want anyone shadowing this object.
+ * Returns      : int 1 - always.
+ */
+public nomask int
+query_prevent_shadow()
+{
+    return 1;
+}
@@ -8,10 +8,40 @@
 #pragma strict_types
 
 #include <const.h>
+#include <macros.h>
 #include <state_desc.h>
 #include <ss_types.h>
 #include <stdproperties.h>
 
+/*
+ * The number of results kept per helper in the memo. When a table is full,
+ * it starts over.
+ */
+#define MEMO_SIZE     (1000)
+
+#define MEMO_HITS     (0)
+#define MEMO_MISSES   (1)
+#define MEMO_FLUSHES  (2)
+
+/*
+ * The nouns that are put in the memo when this object is loaded.
+ */
+#define COMMON_NOUNS ({ "amulet", "apple", "arm", "armour", "arrow", "axe", \
+    "backpack", "bag", "bat", "bear", "bed", "belt", "boat", "bone", "book", \
+    "boot", "bottle", "bow", "bowl", "box", "branch", "bread", "brooch", \
+    "bush", "candle", "cap", "cat", "chair", "chest", "child", "cloak", \
+    "club", "coin", "corpse", "cow", "cup", "dagger", "deer", "dog", "door", \
+    "dwarf", "ear", "elf", "eye", "feather", "finger", "fish", "flower", \
+    "foot", "fox", "fur", "gem", "glove", "gnome", "goblin", "guard", \
+    "halberd", "hammer", "hand", "hat", "head", "helm", "helmet", "herb", \
+    "hide", "hobbit", "horse", "human", "key", "knife", "lamp", "leaf", \
+    "leg", "mace", "man", "map", "merchant", "mushroom", "necklace", "orc", \
+    "pebble", "plate", "potion", "pouch", "rat", "ring", "robe", "rock", \
+    "rope", "sack", "scroll", "sheep", "shield", "shirt", "shoe", "skin", \
+    "skull", "snake", "soldier", "spear", "spider", "staff", "stick", \
+    "stone", "sword", "table", "tooth", "torch", "tree", "troll", "tunic", \
+    "wand", "wolf", "woman" })
+
 /* Global variables. */
 static string *nums, *numt, *numnt, *numo;
 int    *stat_levels, *exp_levels;
@@ -20,6 +50,22 @@ mixed  stat_strings;
 mapping irregular_plural;
 string *plurals;
 
+/*
+ * The memo of the helpers below. They are not saved.
+ *
+ * memo       - ([ (string) helper : ([ (mixed) argument : ({ result }) ]) ])
+ * memo_stats - ([ (string) helper : ({ (int) hits, (int) misses,
+ *                                      (int) flushes }) ])
+ */
+static mapping memo = ([ ]);
+static mapping memo_stats = ([ ]);
+
+/*
+ * Prototypes.
+ */
+static int    calc_number_word(string str);
+static void   preseed_memo();
+
 void
 create()
 {
@@ -194,6 +240,48 @@ create()
     exp_levels = SD_AV_LEVELS;
     exp_titles = SD_AV_TITLES;
 
+    preseed_memo();
+}
+
+/*
+ * Function name: memoize
+ * Description  : Gives the result of a helper from the memo, or computes it
+ *                and keeps it there. The result is kept in an array, so that
+ *                an empty result, like the 0 that number_word() gives for
+ *                most words, is kept too.
+ * Arguments    : string name - the name of the helper.
+ *                mixed arg - the argument to the helper.
+ *                function calc - the function that computes the result.
+ * Returns      : mixed - the result.
+ */
+static mixed
+memoize(string name, mixed arg, function calc)
+{
+    mapping table = memo[name];
+    mixed   result;
+
+    if (!mappingp(table))
+    {
+        memo[name] = table = ([ ]);
+        memo_stats[name] = ({ 0, 0, 0 });
+    }
+
+    if (pointerp(result = table[arg]))
+    {
+        memo_stats[name][MEMO_HITS]++;
+        return result[0];
+    }
+
+    memo_stats[name][MEMO_MISSES]++;
+    result = calc(arg);
+    if (m_sizeof(table) >= MEMO_SIZE)
+    {
+        memo[name] = table = ([ ]);
+        memo_stats[name][MEMO_FLUSHES]++;
+    }
+    table[arg] = ({ result });
+
+    return result;
 }
 
 #define CFUN
@@ -428,8 +516,8 @@ plural_word(string str)
 }
 #endif
 
-string
-plural_sentence(string str)
+static string
+calc_plural_sentence(string str)
 {
     int  c;
     string *a;
@@ -452,6 +540,12 @@ plural_sentence(string str)
     return implode(a, " ");
 }
 
+string
+plural_sentence(string str)
+{
+    return memoize("plural_sentence", str, calc_plural_sentence);
+}
+
 /*
  * Naively check if this word is likely to be a plural
  */
@@ -506,6 +600,12 @@ name_possessive(string str)
  */
 int
 number_word(string str)
+{
+    return memoize("number_word", str, calc_number_word);
+}
+
+static int
+calc_number_word(string str)
 {
     string *ex;
     int value, pos;
@@ -552,8 +652,8 @@ number_word(string str)
     return value;
 }
 
-string
-singular_form(string str)
+static string
+calc_singular_form(string str)
 {
     string singular, one, two, three;
     int last;
@@ -602,6 +702,174 @@ singular_form(string str)
     return extract(str, 0, last - 3);
 }
 
+string
+singular_form(string str)
+{
+    return memoize("singular_form", str, calc_singular_form);
+}
+
+/*
+ * Function name: preseed_memo
+ * Description  : Puts the most common nouns and numbers in the memo, so that
+ *                they are found there from the start.
+ */
+static void
+preseed_memo()
+{
+    int num = 19;
+
+    foreach(string noun: COMMON_NOUNS)
+    {
+        singular_form(plural_sentence(noun));
+        number_word(noun);
+    }
+
+    while (++num <= 100)
+    {
+        number_word(word_number(num));
+    }
+
+    /* The preseed does not count as use. */
+    foreach(string name: m_indices(memo_stats))
+    {
+        memo_stats[name] = ({ 0, 0, 0 });
+    }
+}
+
+/*
+ * Function name: query_memo_status
+ * Description  : Gives the use of the memo of the language helpers.
+ * Returns      : string - the report.
+ */
+public string
+query_memo_status()
+{
+    string text = sprintf("%-16s %6s %9s %9s %6s %7s\n", "Helper", "Kept",
+        "Hits", "Misses", "Hit%", "Flushes");
+    int   *stats;
+
+    foreach(string name: sort_array(m_indices(memo_stats)))
+    {
+        stats = memo_stats[name];
+        text += sprintf("%-16s %6d %9d %9d %6d %7d\n", name,
+            m_sizeof(memo[name]), stats[MEMO_HITS], stats[MEMO_MISSES],
+            (stats[MEMO_HITS] * 100) /
+            max(stats[MEMO_HITS] + stats[MEMO_MISSES], 1),
+            stats[MEMO_FLUSHES]);
+    }
+
+    return text;
+}
+
+/*
+ * Function name: cost_helper
+ * Description  : Measures the eval cost of calling a helper on a list of
+ *                words.
+ * Arguments    : function helper - the helper.
+ *                string *words - the words.
+ * Returns      : int - the eval cost.
+ */
+static int
+cost_helper(function helper, string *words)
+{
+    int cost = EVAL_COST;
+
+    foreach(string word: words)
+    {
+        helper(word);
+    }
+
+    return EVAL_COST - cost;
+}
+
+/*
+ * Function name: check_memo
+ * Description  : Checks that the helpers give the same result with and
+ *                without the memo over a large list of words and numbers.
+ *                Every word is asked twice, so that both the computed and
+ *                the kept result are checked. Then it measures the eval
+ *                cost of every helper with and without the memo on the
+ *                common nouns and the numbers up to 100, which fit in the
+ *                memo, as the words of a running game mostly do. The check
+ *                is done with an empty memo, which is put back afterwards.
+ * Returns      : string - the report.
+ */
+public string
+check_memo()
+{
+    mapping old_memo = memo;
+    mapping old_stats = memo_stats;
+    string *words = ({ });
+    string *sample = ({ });
+    string *errors = ({ });
+    string  report;
+    int     num = -5;
+    int     pass = 0;
+
+    foreach(string noun: m_indices(irregular_plural) + COMMON_NOUNS)
+    {
+        words += ({ noun, capitalize(noun), "small " + noun,
+            noun + " of steel", "pair of " + noun, plural_word(noun) });
+    }
+    while (++num <= 2000)
+    {
+        words += ({ word_number(num) });
+    }
+
+    memo = ([ ]);
+    memo_stats = ([ ]);
+    while (++pass <= 2)
+    {
+        foreach(string word: words)
+        {
+            if (plural_sentence(word) != calc_plural_sentence(word))
+                errors += ({ "plural_sentence(\"" + word + "\")" });
+            if (singular_form(word) != calc_singular_form(word))
+                errors += ({ "singular_form(\"" + word + "\")" });
+            if (number_word(word) != calc_number_word(word))
+                errors += ({ "number_word(\"" + word + "\")" });
+        }
+    }
+    report = sprintf("Checked %d words twice: %d differences.\n",
+        sizeof(words), sizeof(errors)) +
+        (sizeof(errors) ? (implode(errors[..19], "\n") + "\n") : "");
+
+    foreach(string noun: COMMON_NOUNS)
+    {
+        sample += ({ noun, "small " + noun, noun + " of steel",
+            plural_word(noun) });
+    }
+    num = 0;
+    while (++num <= 100)
+    {
+        sample += ({ word_number(num) });
+    }
+
+    /* Fill the memo first, so that only the kept results are measured. */
+    memo = ([ ]);
+    memo_stats = ([ ]);
+    map(sample, plural_sentence);
+    map(sample, singular_form);
+    map(sample, number_word);
+
+    report += sprintf("Eval cost over %d words, without and with memo:\n",
+        sizeof(sample)) +
+        sprintf("%-16s %8d %8d\n", "plural_sentence",
+        cost_helper(calc_plural_sentence, sample),
+        cost_helper(plural_sentence, sample)) +
+        sprintf("%-16s %8d %8d\n", "singular_form",
+        cost_helper(calc_singular_form, sample),
+        cost_helper(singular_form, sample)) +
+        sprintf("%-16s %8d %8d\n", "number_word",
+        cost_helper(calc_number_word, sample),
+        cost_helper(number_word, sample));
+
+    memo = old_memo;
+    memo_stats = old_stats;
+
+    return report;
+}
+
 /*
  * Function name: lang_short
  * Description  : Returns the short description without article. This routine
@@ -15,6 +15,31 @@
 /* Prototypes. */
 int *what_coins(mixed ob);
 
+/*
+ * Function name: coin_heap
+ * Description:   Finds the heap of coins of a type in an object. Containers
+ *                keep a ledger of their coins, so the inventory need not be
+ *                searched.
+ * Arguments:     ob: The object to search.
+ *                str: Cointype: copper,silver,gold or platinum
+ * Returns:       Objectpointer to the coins object or 0.
+ */
+static object
+coin_heap(object ob, string str)
+{
+    if (!objectp(ob))
+    {
+        return 0;
+    }
+
+    if (function_exists("query_coin_heap", ob))
+    {
+        return ob->query_coin_heap(str);
+    }
+
+    return present(str + " coin", ob);
+}
+
 /*
  * Function name: split_values 
  * Description:   Splits a 'copper' value into pc, gc, sc, cc
@@ -129,7 +154,7 @@ move_coins(string str, int num, mixed from, mixed to)
         t = 0;
 
     if (f)
-        cf = present(str+" coin",f);
+        cf = coin_heap(f, str);
     else
         cf = make_coins(str, num);
 
@@ -155,8 +180,11 @@ move_coins(string str, int num, mixed from, mixed to)
 }
 
 /*
- * Function name: move_cointypes
- * Description:   Move a certain number of each coin type.
+ * Function name: transfer
+ * Description:   Moves a number of coins of each type in one pass. All coins
+ *                are checked before anything is moved, and when a move fails
+ *                the moves done before it are undone, so either all coins
+ *                are moved or none. Only real coins are moved.
  * Arguments:     (int *)  An integer array containing the number of each
  *                         coin type to move.
  *                (object) Where to take the coins from--0 if they are to
@@ -168,51 +196,129 @@ move_coins(string str, int num, mixed from, mixed to)
  *                >0 - Move error code
  */
 public int
-move_cointypes(int *coins, object from, object to)
+transfer(int *coins, object from, object to)
 {
-    int i, j, res;
-    int *all_coins;
+    object *heaps;
+    int index, undo, size, res;
 
-    if (from)    
+    if (sizeof(coins) < SIZEOF_MONEY_TYPES)
     {
-        all_coins = what_coins(from);
+        return -1;
+    }
 
-        /* Check that coins are present before we start removing them.
-         * This lessens the chance of having to restore coins later.
-         */
-        for (i = 0; i < sizeof(MONEY_TYPES); i++)
+    /* Check that all coins are present before we start moving them. */
+    heaps = allocate(SIZEOF_MONEY_TYPES);
+    index = -1;
+    while(++index < SIZEOF_MONEY_TYPES)
+    {
+        if (coins[index] < 0)
         {
-            if (coins[i] > all_coins[i])
-            {
-                return -1;
-            }
+            return -1;
+        }
+
+        if (!from || !coins[index])
+        {
+            continue;
+        }
+
+        heaps[index] = coin_heap(from, MONEY_TYPES[index]);
+        if (!objectp(heaps[index]) ||
+            (function_exists("create_heap", heaps[index]) != "/std/coins") ||
+            (heaps[index]->num_heap() < coins[index]))
+        {
+            return -1;
         }
     }
-    
-    for (i = 0; i < sizeof(MONEY_TYPES); i++)
+
+    index = -1;
+    while(++index < SIZEOF_MONEY_TYPES)
     {
-        if (coins[i] == 0)
+        if (!coins[index])
         {
             continue;
         }
-    
-        if ((res = move_coins(MONEY_TYPES[i], coins[i], from, to)) != 0)
+
+        if (!from)
         {
-            /* We were unable to move some coins, so we have to undo
-             * previous transfers.
-             */
-            for (j = 0; j < i; j++)
+            /* Creating and destroying the same coins is nothing at all. */
+            if (!to)
             {
-                move_coins(MONEY_TYPES[j], coins[j], to, from);
+                continue;
             }
-    
-            return res;
+
+            heaps[index] = make_coins(MONEY_TYPES[index], coins[index]);
+            if (!(res = heaps[index]->move(to)))
+            {
+                continue;
+            }
+
+            heaps[index]->remove_object();
         }
+        else
+        {
+            size = heaps[index]->num_heap();
+
+            if (!to)
+            {
+                if (coins[index] < size)
+                {
+                    heaps[index]->set_heap_size(size - coins[index]);
+                }
+                else
+                {
+                    heaps[index]->remove_object();
+                }
+                continue;
+            }
+
+            if (coins[index] < size)
+            {
+                heaps[index]->split_heap(coins[index]);
+            }
+            if (!(res = heaps[index]->move(to)))
+            {
+                continue;
+            }
+        }
+
+        /* We were unable to move some coins, so we have to undo previous
+         * transfers.
+         */
+        undo = -1;
+        while(++undo < index)
+        {
+            if (coins[undo])
+            {
+                move_coins(MONEY_TYPES[undo], coins[undo], to, from);
+            }
+        }
+
+        return res;
     }
-    
+
     return 0;
 }
 
+/*
+ * Function name: move_cointypes
+ * Description:   Move a certain number of each coin type. This is the same
+ *                as transfer().
+ * Arguments:     (int *)  An integer array containing the number of each
+ *                         coin type to move.
+ *                (object) Where to take the coins from--0 if they are to
+ *                         be newly created.
+ *                (object) Where to put the coins--0 if they are to be
+ *                         destroyed.
+ * Returns:       -1 - Not enough coins found
+ *                 0 - Move successful
+ *                >0 - Move error code
+ */
+public int
+move_cointypes(int *coins, object from, object to)
+{
+    return transfer(coins, from, to);
+}
+
 /*
  * Function name: what_coins
  * Description:   Finds out what of the normal cointypes a certain object
@@ -244,7 +350,7 @@ what_coins(mixed ob)
 
     while(++index < SIZEOF_MONEY_TYPES)
     {
-        cn = present(MONEY_TYPES[index] + " coin", pl);
+        cn = coin_heap(pl, MONEY_TYPES[index]);
         if (!cn)
         {
             nums[index] = 0;
@@ -328,7 +434,7 @@ take_money(object who, int amount)
     
     for (i = 0; i < SIZEOF_MONEY_TYPES; i++)
     {
-        ob = present(MONEY_TYPES[i] + " coin", who);
+        ob = coin_heap(who, MONEY_TYPES[i]);
         if (ob)
         {
             ob_list[i] = ob;
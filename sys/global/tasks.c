@@ -0,0 +1,197 @@
+/*
+ * /sys/global/tasks.c
+ *
+ * Compiles skill lists for resolve_task() into task descriptors. See
+ * TASK_COMPILE in <tasks.h>.
+ *
+ * The descriptor gives the same die roll modifier as the skill list it was
+ * made from. The rules of find_drm() in /std/living/tasks.c are kept: a
+ * weight stays in effect until a member yields a non-zero value, after which
+ * the weight returns to 100. Constant values are added to the constant part
+ * of the descriptor when the weight that applies to them is known.
+ */
+
+#pragma no_clone
+#pragma no_inherit
+#pragma save_binary
+#pragma strict_types
+
+#include <macros.h>
+#include <tasks.h>
+
+/*
+ * Function name: member_kind
+ * Description  : Finds out what kind of member of a skill list this is.
+ *                Compare with find_listval() in /std/living/tasks.c.
+ * Arguments    : mixed member - the member.
+ * Returns      : int - the kind, TASK_KIND_*.
+ */
+static int
+member_kind(mixed member)
+{
+    if (functionp(member))
+        return TASK_KIND_FUNCTION;
+    if (stringp(member) && strlen(member) && member[0] == '@')
+        return TASK_KIND_VBFC;
+    if (stringp(member))
+        return TASK_KIND_PROP;
+    if (!intp(member))
+        return TASK_KIND_ZERO;
+    if (member < 0 && member > -11)
+        return TASK_KIND_STAT;
+    return TASK_KIND_SKILL;
+}
+
+/*
+ * Function name: member_key
+ * Description  : Gives the key for a member of a given kind. Stats are
+ *                translated from TS_* to SS_*.
+ * Arguments    : int kind - the kind of the member.
+ *                mixed member - the member.
+ * Returns      : mixed - the key.
+ */
+static mixed
+member_key(int kind, mixed member)
+{
+    switch(kind)
+    {
+    case TASK_KIND_STAT:
+        return (-member) - 1;
+    case TASK_KIND_ZERO:
+        return 0;
+    default:
+        return member;
+    }
+}
+
+/*
+ * Function name: compile_group
+ * Description  : Compiles the members of a SKILL_MIN, SKILL_MAX or
+ *                SKILL_AVG group.
+ * Arguments    : int op - the operation, TASK_OP_*.
+ *                mixed *members - the members up to (excluding) SKILL_END.
+ * Returns      : mixed * - the compiled operation.
+ */
+static mixed *
+compile_group(int op, mixed *members)
+{
+    int *kinds = map(members, member_kind);
+    mixed *keys = allocate(sizeof(members));
+    int index = sizeof(members);
+
+    while(--index >= 0)
+    {
+        keys[index] = member_key(kinds[index], members[index]);
+    }
+
+    return ({ op, kinds, keys });
+}
+
+/*
+ * Function name: compile_task
+ * Called from  : TASK_COMPILE(list) in <tasks.h>
+ * Description  : Compiles a skill list into a task descriptor.
+ * Arguments    : mixed *skill_list - the skill list, see resolve_task().
+ * Returns      : mixed * - the task descriptor.
+ */
+public mixed *
+compile_task(mixed *skill_list)
+{
+    mixed *ops = ({ });
+    int    constant = 0;
+    int    weight = 100;  /* The weight for the next member, */
+    int    known = 1;     /* if it is known at this point. */
+    int    size;
+    int    index;
+    int    start;
+    int    kind;
+    int    value;
+
+    if (!pointerp(skill_list))
+        return ({ TASK_COMPILED, 0, 0 });
+    if (IS_COMPILED_TASK(skill_list))
+        return skill_list;
+
+    size = sizeof(skill_list);
+    index = 0;
+    while (index < size)
+    {
+        if (functionp(skill_list[index]) || stringp(skill_list[index]))
+        {
+            kind = member_kind(skill_list[index]);
+            ops += ({ ({ TASK_OP_ONE, kind,
+                member_key(kind, skill_list[index++]) }) });
+            known = (known && (weight == 100));
+            continue;
+        }
+
+        switch (skill_list[index])
+        {
+        case SKILL_MIN:
+        case SKILL_MAX:
+        case SKILL_AVG:
+            start = ++index;
+            while ((index < size) && (skill_list[index] != SKILL_END))
+                index++;
+            ops += ({ compile_group(([ SKILL_MIN : TASK_OP_MIN,
+                SKILL_MAX : TASK_OP_MAX, SKILL_AVG : TASK_OP_AVG ])
+                [skill_list[start - 1]],
+                ((index > start) ? skill_list[start..(index - 1)] : ({ }) )) });
+            known = (known && (weight == 100));
+            break;
+
+        case SKILL_WEIGHT:
+            index++;
+            weight = skill_list[index++];
+            known = 1;
+            /* Two weights in a row: the last one wins. */
+            if (sizeof(ops) && (ops[sizeof(ops) - 1][0] == TASK_OP_WEIGHT))
+                ops[sizeof(ops) - 1] = ({ TASK_OP_WEIGHT, weight });
+            else
+                ops += ({ ({ TASK_OP_WEIGHT, weight }) });
+            break;
+
+        case SKILL_VALUE:
+            index++;
+            value = skill_list[index++];
+            /* A zero value does not change anything. */
+            if (!value)
+                break;
+
+            /* Unknown weight, we must do it at runtime. */
+            if (!known)
+            {
+                ops += ({ ({ TASK_OP_VALUE, value }) });
+                weight = 100;
+                known = 1;
+                break;
+            }
+
+            constant += weight * value / 100;
+            /* After a non-zero value the weight is reset to 100. */
+            if (weight != 100)
+            {
+                if (sizeof(ops) && (ops[sizeof(ops) - 1][0] == TASK_OP_WEIGHT))
+                    ops[sizeof(ops) - 1] = ({ TASK_OP_WEIGHT, 100 });
+                else
+                    ops += ({ ({ TASK_OP_WEIGHT, 100 }) });
+                weight = 100;
+            }
+            break;
+
+        case SKILL_END:
+            /* Stray end markers do not change anything. */
+            index++;
+            break;
+
+        default:
+            kind = member_kind(skill_list[index]);
+            ops += ({ ({ TASK_OP_ONE, kind,
+                member_key(kind, skill_list[index++]) }) });
+            known = (known && (weight == 100));
+            break;
+        }
+    }
+
+    return ({ TASK_COMPILED, constant, size }) + ops;
+}
@@ -36,6 +36,7 @@
 #define GMCP_FILES_DIR_LIST       "files.dir.list"
 #define GMCP_FILES_READ           "files.read"
 #define GMCP_FILES_WRITE          "files.write"
+#define GMCP_FILES_WRITE_STATUS   "files.write.status"
 #define GMCP_ROOM_INFO            "room.info"
 #define GMCP_ROOM_MAP             "room.map"
 
@@ -105,10 +106,17 @@
 #define GMCP_ZOOMX     "zoomx"
 #define GMCP_ZOOMY     "zoomy"
 /* Files */
+#define GMCP_ABORT     "abort"
+#define GMCP_CHECKSUM  "checksum"
 #define GMCP_DIRS      "dirs"
+#define GMCP_ERROR     "error"
 #define GMCP_FILES     "files"
+#define GMCP_LENGTH    "length"
+#define GMCP_OFFSET    "offset"
 #define GMCP_PATH      "path"
+#define GMCP_SESSION   "session"
 #define GMCP_SIZE      "size"
+#define GMCP_STATUS    "status"
 #define GMCP_TEXT      "text"
 #define GMCP_TIME      "time"
 
@@ -118,6 +126,9 @@
 /* Interval for the alarm to run on players using GMCP. */
 #define GMCP_INTERVAL  60.0
 
+/* The largest part of a file sent or received in one Files package. */
+#define GMCP_CHUNK_SIZE 8192
+
 /* The token to identify a player with, based on his name and last login time. */
 #define GMCP_PLAYER_TOKEN(name, login_time) (crypt((name), "$1$" + (login_time) + "$")[-8..])
 
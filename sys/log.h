@@ -169,7 +169,17 @@
 #define LOG_BOOKKEEP_LIMIT_Q  1000
 #define LOG_BOOKKEEP_LIMIT_G  2500
 #define LOG_BOOKKEEP_LIMIT_C 10000
-#define LOG_BOOKKEEP_ROTATE "domain_xp/XP"
+
+/*
+ * LOG_BOOKKEEP_ROLLUP - If defined, all xp given by domains to mortals is
+ * added up per day, domain, wizard and type. The totals are saved in one
+ * file per day with this prefix, followed by the date. They are kept for
+ * LOG_BOOKKEEP_KEEP days.
+ *
+ * Used in: /secure/master/fob.c
+ */
+#define LOG_BOOKKEEP_ROLLUP "domain_xp/rollup"
+#define LOG_BOOKKEEP_KEEP   (92)
 
 /*
  * LOG_BOOKKEEP_ERR - If defined, the file where all exp that cannot be put
@@ -222,6 +232,14 @@
 #define LOG_STRANGE_LOGIN "STRANGE_LOGIN"
 #define LOG_SECOND_LOGIN  "SECOND_LOGIN"
 
+/*
+ * LOG_LOGIN_ERROR - If defined, it will log the errors in the stages of the
+ * login that are run through the login pipeline.
+ *
+ * Used in /secure/login_pipeline.c
+ */
+#define LOG_LOGIN_ERROR "LOGIN_ERROR"
+
 /*
  * STEAL_EXP - If defined, it will log the experience awareded for the theft.
  *
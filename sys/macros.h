@@ -183,5 +183,12 @@
 #define OBJECT_HASH(obj) STRING_HASH(file_name(obj))
 #define MASTER_HASH(obj) STRING_HASH(MASTER_OB(obj))
 
+/*
+ * EVAL_COST - gives the current value of the evaluation cost counter of the
+ *             gamedriver. The difference between two readings is the cost
+ *             of the code executed in between. Used for profiling.
+ */
+#define EVAL_COST ((int)"/secure/master"->do_debug("get_eval_cost"))
+
 /* No definitions beyond this line. */
 #endif MACROS_DEF
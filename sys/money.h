@@ -74,6 +74,15 @@
 #define MONEY_MOVE_COIN_TYPES(carr, from, to) \
     ((int)MONEY_FN->move_cointypes(carr, from, to))
 
+/*
+ * MONEY_TRANSFER moves a specified number of each coin type from 'from' to
+ * 'to' in one pass. It finds the coins through the coin ledger the
+ * containers keep and either moves all coins or none. Only real coins are
+ * moved. The result is identical to MONEY_MOVE_COIN_TYPES.
+ */
+#define MONEY_TRANSFER(carr, from, to) \
+    ((int)MONEY_FN->transfer(carr, from, to))
+
 /*
  * MONEY_ADD will add 'amount' of money to 'who' in the largest
  * denominations possible. If amount < 0 money will be taken in the
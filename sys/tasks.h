@@ -42,4 +42,45 @@
 #define TS_OCC    -8
 #define TS_CRAFT  -10
 
+/*
+ * Skill lists can be compiled once into a task descriptor, which can be
+ * passed to resolve_task() and find_drm() instead of the skill list. The
+ * members are resolved into their kinds and constant values are folded, so
+ * resolving it is a lot cheaper. Compile it in the constructor, e.g.:
+ *
+ *     sneak_task = TASK_COMPILE(({ TS_DEX, SKILL_AVG, SS_SNEAK, SS_HIDE,
+ *         SKILL_END }));
+ */
+#ifndef TASK_FILE
+#define TASK_FILE "/sys/global/tasks"
+#endif  TASK_FILE
+
+#define TASK_COMPILE(list) ((mixed *)call_other(TASK_FILE, "compile_task", (list)))
+#define IS_COMPILED_TASK(list) (sizeof(list) && ((list)[0] == TASK_COMPILED))
+
+/*
+ * The layout of a task descriptor. These are for internal use only.
+ *
+ * ({ TASK_COMPILED, (int) constant drm, (int) size of the skill list,
+ *    ({ op, arg1, arg2 }), ... })
+ */
+#define TASK_COMPILED    "#compiled task#"
+#define TASK_CONSTANT    1
+#define TASK_LIST_SIZE   2
+#define TASK_FIRST_OP    3
+
+#define TASK_OP_ONE      1  /* ({ op, kind, key }) */
+#define TASK_OP_MIN      2  /* ({ op, kinds, keys }) */
+#define TASK_OP_MAX      3  /* ({ op, kinds, keys }) */
+#define TASK_OP_AVG      4  /* ({ op, kinds, keys }) */
+#define TASK_OP_WEIGHT   5  /* ({ op, weight }) */
+#define TASK_OP_VALUE    6  /* ({ op, value }) */
+
+#define TASK_KIND_ZERO     0
+#define TASK_KIND_SKILL    1
+#define TASK_KIND_STAT     2
+#define TASK_KIND_PROP     3
+#define TASK_KIND_VBFC     4
+#define TASK_KIND_FUNCTION 5
+
 #endif